@@ -15,6 +15,7 @@
 #include <AMReX_FabSet.H>
 #include <AMReX_StateData.H>
 #include <AMReX_PlotFileUtil.H>
+#include <AMReX_InSituReduce.H>
 #include <AMReX_Print.H>
 
 #ifdef BL_LAZY
@@ -79,7 +80,10 @@ namespace
     int  probinit_natonce;
 #endif
     bool plot_files_output;
+    bool plot_reduce_only;
     int  checkpoint_nfiles;
+    int  checkpoint_delta;
+    bool restart_file_affinity;
     int  regrid_on_restart;
     int  use_efficient_regrid;
     int  plotfile_on_restart;
@@ -90,6 +94,25 @@ namespace
     bool prereadFAHeaders;
     VisMF::Header::Version plot_headerversion(VisMF::Header::Version_v1);
     VisMF::Header::Version checkpoint_headerversion(VisMF::Header::Version_v1);
+
+    // Restores VisMF's read flags however restart exits.
+    struct [[nodiscard]] VisMFReadFlagsGuard
+    {
+        VisMFReadFlagsGuard () noexcept
+            : m_synchronous(VisMF::GetUseSynchronousReads()),
+              m_single(VisMF::GetUseSingleRead()) {}
+        ~VisMFReadFlagsGuard () {
+            VisMF::SetUseSynchronousReads(m_synchronous);
+            VisMF::SetUseSingleRead(m_single);
+        }
+        VisMFReadFlagsGuard (VisMFReadFlagsGuard const&) = delete;
+        VisMFReadFlagsGuard (VisMFReadFlagsGuard &&) = delete;
+        VisMFReadFlagsGuard& operator= (VisMFReadFlagsGuard const&) = delete;
+        VisMFReadFlagsGuard& operator= (VisMFReadFlagsGuard &&) = delete;
+    private:
+        bool m_synchronous;
+        bool m_single;
+    };
 }
 
 
@@ -116,6 +139,9 @@ Amr::Initialize ()
 #endif
     plot_files_output        = true;
     checkpoint_nfiles        = 64;
+    checkpoint_delta         = 0;
+    plot_reduce_only         = false;
+    restart_file_affinity    = false;
     regrid_on_restart        = 0;
     use_efficient_regrid     = 0;
     plotfile_on_restart      = 0;
@@ -519,6 +545,8 @@ Amr::initInSitu()
 int
 Amr::updateInSitu() // NOLINT(readability-convert-member-functions-to-static)
 {
+    reduceInSitu(false);
+
 #if defined(AMREX_USE_SENSEI_INSITU) && !defined(AMREX_NO_SENSEI_AMR_INST)
     if (insitu_bridge && insitu_bridge->update(this))
     {
@@ -529,6 +557,41 @@ Amr::updateInSitu() // NOLINT(readability-convert-member-functions-to-static)
     return 0;
 }
 
+void
+Amr::reduceInSitu (bool at_plotfile)
+{
+    auto reducers = at_plotfile ? InSituReduce::PlotfileReducers()
+                                : InSituReduce::ScheduledReducers(level_steps[0]);
+    if (reducers.empty()) {
+        return;
+    }
+
+    BL_PROFILE("Amr::reduceInSitu()");
+
+    InSituData data;
+    data.nlevels = finest_level + 1;
+    data.varnames = InSituReduce::Variables(reducers);
+    data.time = cumtime;
+    data.step = level_steps[0];
+
+    const int nvars = static_cast<int>(data.varnames.size());
+    Vector<MultiFab> mf(data.nlevels);
+    for (int lev = 0; lev <= finest_level; ++lev) {
+        mf[lev].define(boxArray(lev), DistributionMap(lev), nvars, 0);
+        for (int n = 0; n < nvars; ++n) {
+            auto var = amr_level[lev]->derive(data.varnames[n], cumtime, 0);
+            MultiFab::Copy(mf[lev], *var, 0, n, 1, 0);
+        }
+        data.mf.push_back(&mf[lev]);
+        data.geom.push_back(Geom(lev));
+        if (lev < finest_level) {
+            data.ref_ratio.push_back(refRatio(lev));
+        }
+    }
+
+    InSituReduce::Reduce(reducers, data);
+}
+
 int
 Amr::finalizeInSitu()
 {
@@ -853,15 +916,21 @@ Amr::writePlotFile ()
                                                     level_steps[0],
                                                     file_name_digits);
 
-    if (verbose > 0) {
-        amrex::Print() << "PLOTFILE: file = " << pltfile << '\n';
-    }
+    reduceInSitu(true);
 
-    if (record_run_info && ParallelDescriptor::IOProcessor()) {
-        runlog << "PLOTFILE: file = " << pltfile << '\n';
-    }
+    if (plot_reduce_only) {
+        last_plotfile = level_steps[0];
+    } else {
+        if (verbose > 0) {
+            amrex::Print() << "PLOTFILE: file = " << pltfile << '\n';
+        }
 
-    writePlotFileDoit(pltfile, true);
+        if (record_run_info && ParallelDescriptor::IOProcessor()) {
+            runlog << "PLOTFILE: file = " << pltfile << '\n';
+        }
+
+        writePlotFileDoit(pltfile, true);
+    }
 
     BL_PROFILE_REGION_STOP("Amr::writePlotFile()");
 }
@@ -910,6 +979,8 @@ Amr::writePlotFileDoit (std::string const& pltfile, bool regular)
 {
     auto dPlotFileTime0 = amrex::second();
 
+    AsyncOut::ScopedStream async_stream(AsyncOut::PlotfileStream);
+
     VisMF::SetNOutFiles(plot_nfiles);
     VisMF::Header::Version currentVersion(VisMF::GetHeaderVersion());
     VisMF::SetHeaderVersion(plot_headerversion);
@@ -1368,6 +1439,12 @@ Amr::restart (const std::string& filename)
 
     VisMF::SetMFFileInStreams(mffile_nstreams);
 
+    VisMFReadFlagsGuard read_flags_guard;
+    if (restart_file_affinity) {
+        VisMF::SetUseSynchronousReads(true);
+        VisMF::SetUseSingleRead(true);
+    }
+
     if (verbose > 0) {
         amrex::Print() << "restarting calculation from file: " << filename << "\n";
     }
@@ -1654,6 +1731,12 @@ Amr::restart (const std::string& filename)
     last_checkpoint = level_steps[0];
     last_plotfile = level_steps[0];
 
+    // The next delta checkpoint refers to the one we restarted from.
+    if (checkpoint_delta > 0) {
+        last_checkpoint_file = filename;
+        n_delta_checkpoints = 0;
+    }
+
     for (int lev = 0; lev <= finest_level; ++lev)
     {
         Box restart_domain(Geom(lev).Domain());
@@ -1690,6 +1773,9 @@ Amr::checkPoint ()
     BL_PROFILE_REGION_START("Amr::checkPoint()");
     BL_PROFILE("Amr::checkPoint()");
 
+    // Checkpoints are written ahead of plotfiles waiting for an I/O thread.
+    AsyncOut::ScopedStream async_stream(AsyncOut::CheckpointStream, 1);
+
     VisMF::SetNOutFiles(checkpoint_nfiles);
     //
     // In checkpoint files always write out FABs in NATIVE format.
@@ -1796,10 +1882,20 @@ Amr::checkPoint ()
         amr_level[i]->checkPointPre(ckfileTemp, HeaderFile);
     }
 
+    // ---- delta checkpoints are not supported by AsyncOut
+    const bool delta_checkpoint = checkpoint_delta > 0 && ! AsyncOut::UseAsyncOut();
+    const bool full_checkpoint = last_checkpoint_file.empty() || last_checkpoint_file == ckfile
+                                 || n_delta_checkpoints + 1 >= checkpoint_delta;
+    if (delta_checkpoint) {
+        StateData::SetDeltaCheckPoint(true, full_checkpoint ? std::string() : last_checkpoint_file);
+    }
+
     for (int i = 0; i <= finest_level; ++i) {
         amr_level[i]->checkPoint(ckfileTemp, HeaderFile);
     }
 
+    StateData::SetDeltaCheckPoint(false);
+
     for (int i = 0; i <= finest_level; ++i) {
         amr_level[i]->checkPointPost(ckfileTemp, HeaderFile);
     }
@@ -1831,6 +1927,11 @@ Amr::checkPoint ()
 
     last_checkpoint = level_steps[0];
 
+    if (delta_checkpoint) {
+        last_checkpoint_file = ckfile;
+        n_delta_checkpoints = full_checkpoint ? 0 : n_delta_checkpoints + 1;
+    }
+
     if (verbose > 0)
     {
         auto dCheckPointTime = amrex::second() - dCheckPointTime0;
@@ -3184,6 +3285,24 @@ Amr::initPltAndChk ()
     if (plot_nfiles       == -1) plot_nfiles       = ParallelDescriptor::NProcs();
     if (checkpoint_nfiles == -1) checkpoint_nfiles = ParallelDescriptor::NProcs();
 
+    //
+    // N > 0 ==> write only the FABs that changed since the previous checkpoint,
+    //           with a full checkpoint every N checkpoints.
+    //
+    pp.queryAdd("checkpoint_delta", checkpoint_delta);
+
+    //
+    // Run the in-situ reducers (see InSituReduce) at plotfile times, but
+    // do not write the plotfiles.
+    //
+    pp.queryAdd("plot_reduce_only", plot_reduce_only);
+
+    //
+    // Read the checkpoint data in the order of the files on disk, with
+    // contiguous reads, and only then copy it to the restart distribution.
+    //
+    pp.queryAdd("restart_file_affinity", restart_file_affinity);
+
     check_file_root = "chk";
     pp.queryAdd("check_file",check_file_root);
 
@@ -352,7 +352,7 @@ AmrLevel::writePlotFile (const std::string& dir,
     if (AsyncOut::UseAsyncOut()) {
         VisMF::AsyncWrite(plotMF,TheFullPath);
     } else {
-        VisMF::Write(plotMF,TheFullPath,how,true);
+        VisMF::Write(plotMF,TheFullPath,how,true,VisMF::GetPlotfileErrorBound());
     }
 
     levelDirectoryCreated = false;  // ---- now that the plotfile is finished
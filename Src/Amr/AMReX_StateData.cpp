@@ -26,6 +26,8 @@ static constexpr int MFOLDDATA = 1;
 
 Vector<std::string> StateData::fabArrayHeaderNames;
 std::map<std::string, Vector<char> > *StateData::faHeaderMap;
+bool StateData::deltaCheckPoint(false);
+std::string StateData::deltaRefDir;
 
 
 StateData::StateData ()
@@ -825,8 +827,12 @@ StateData::checkPoint (const std::string& name,
     {
         BL_ASSERT(new_data);
         std::string mf_fullpath_new(fullpathname + NewSuffix);
+        std::string ref_name = deltaRefDir.empty() ? deltaRefDir : deltaRefDir + "/" + name;
         if (AsyncOut::UseAsyncOut()) {
             VisMF::AsyncWrite(*new_data,mf_fullpath_new);
+        } else if (deltaCheckPoint) {
+            VisMF::WriteDelta(*new_data,mf_fullpath_new,
+                              ref_name.empty() ? ref_name : ref_name + NewSuffix,how);
         } else {
             VisMF::Write(*new_data,mf_fullpath_new,how);
         }
@@ -837,6 +843,9 @@ StateData::checkPoint (const std::string& name,
             std::string mf_fullpath_old(fullpathname + OldSuffix);
             if (AsyncOut::UseAsyncOut()) {
                 VisMF::AsyncWrite(*old_data,mf_fullpath_old);
+            } else if (deltaCheckPoint) {
+                VisMF::WriteDelta(*old_data,mf_fullpath_old,
+                                  ref_name.empty() ? ref_name : ref_name + OldSuffix,how);
             } else {
                 VisMF::Write(*old_data,mf_fullpath_old,how);
             }
@@ -41,6 +41,7 @@
 #include <AMReX_iMultiFab.H>
 #include <AMReX_VisMF.H>
 #include <AMReX_AsyncOut.H>
+#include <AMReX_CommProgress.H>
 #endif
 
 #ifdef BL_LAZY
@@ -600,6 +601,7 @@ amrex::Initialize (int& argc, char**& argv, bool build_parm_parse,
     iMultiFab::Initialize();
     VisMF::Initialize();
     AsyncOut::Initialize();
+    CommProgress::Initialize();
     VectorGrowthStrategy::Initialize();
 
 #ifdef AMREX_USE_EB
@@ -47,6 +47,9 @@ namespace {
     Long the_pinned_arena_release_threshold = std::numeric_limits<Long>::max();
     Long the_comms_arena_release_threshold = std::numeric_limits<Long>::max();
     Long the_async_arena_release_threshold = std::numeric_limits<Long>::max();
+    Long the_arena_thread_cache_size = 0L;
+    Long the_pinned_arena_thread_cache_size = 0L;
+    Long thread_cache_max_block = 1024*1024;
     bool the_arena_is_managed = false;
     bool abort_on_out_of_gpu_memory = false;
 }
@@ -299,6 +302,9 @@ Arena::Initialize ()
     pp.queryAdd( "the_pinned_arena_release_threshold",  the_pinned_arena_release_threshold);
     pp.queryAdd("the_comms_arena_release_threshold", the_comms_arena_release_threshold);
     pp.queryAdd(  "the_async_arena_release_threshold",   the_async_arena_release_threshold);
+    pp.queryAdd(       "the_arena_thread_cache_size",        the_arena_thread_cache_size);
+    pp.queryAdd("the_pinned_arena_thread_cache_size", the_pinned_arena_thread_cache_size);
+    pp.queryAdd("thread_cache_max_block", thread_cache_max_block);
     pp.queryAdd("the_arena_is_managed", the_arena_is_managed);
     pp.queryAdd("abort_on_out_of_gpu_memory", abort_on_out_of_gpu_memory);
 
@@ -306,6 +312,7 @@ Arena::Initialize ()
 #if defined(BL_COALESCE_FABS) || defined(AMREX_USE_GPU)
         ArenaInfo ai{};
         ai.SetReleaseThreshold(the_arena_release_threshold);
+        ai.SetThreadCache(thread_cache_max_block, the_arena_thread_cache_size);
         if (the_arena_is_managed) {
             the_arena = new CArena(0, ai.SetPreferred());
 #ifdef AMREX_USE_GPU
@@ -360,7 +367,8 @@ Arena::Initialize ()
     // When USE_CUDA=FALSE, we call mlock to pin the cpu memory.
     // When USE_CUDA=TRUE, we call cudaHostAlloc to pin the host memory.
     the_pinned_arena = new CArena(0, ArenaInfo{}.SetHostAlloc().SetReleaseThreshold
-                                  (the_pinned_arena_release_threshold));
+                                  (the_pinned_arena_release_threshold).SetThreadCache
+                                  (thread_cache_max_block, the_pinned_arena_thread_cache_size));
     the_pinned_arena->registerForProfiling("Pinned Memory");
 
 #ifdef AMREX_USE_GPU
@@ -1,23 +1,101 @@
 #include <AMReX_AsyncOut.H>
-#include <AMReX_BackgroundThread.H>
 #include <AMReX_ParallelDescriptor.H>
 #include <AMReX_Vector.H>
 #include <AMReX_ParmParse.H>
 #include <AMReX_Utility.H>
 #include <AMReX.H>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+
 namespace amrex::AsyncOut {
 
 namespace {
 
 int s_asyncout = false;
 int s_noutfiles = 64;
-MPI_Comm s_comm = MPI_COMM_NULL;
-
-std::unique_ptr<BackgroundThread> s_thread;
+int s_nthreads = 1;
+Vector<MPI_Comm> s_comm; // [stream]
 
 WriteInfo s_info;
 
+struct Job
+{
+    JobId id;
+    int stream;
+    int priority;
+    Vector<JobId> deps;
+    std::function<void()> f;
+};
+
+Vector<std::thread> s_threads;
+std::mutex s_job_mutex;
+std::condition_variable s_job_cond;  // a job was submitted or finished
+std::deque<Job> s_jobs;              // jobs not started, in order of submission
+std::set<JobId> s_unfinished;
+Vector<char> s_stream_busy;
+JobId s_next_id = 0;
+bool s_finalizing = false;
+
+int s_current_stream = 0;
+int s_current_priority = 0;
+thread_local int t_stream = 0;
+
+// The job to run next, or s_jobs.end().  Must hold s_job_mutex.
+std::deque<Job>::iterator next_job ()
+{
+    auto best = s_jobs.end();
+    Vector<char> stream_seen(s_stream_busy);
+    for (auto it = s_jobs.begin(); it != s_jobs.end(); ++it) {
+        // Only the first job of a stream may start, and only if the stream is idle.
+        if (stream_seen[it->stream]) { continue; }
+        stream_seen[it->stream] = 1;
+        bool ready = std::none_of(it->deps.begin(), it->deps.end(),
+                                  [] (JobId d) { return s_unfinished.count(d) > 0; });
+        if (ready && (best == s_jobs.end() || it->priority > best->priority)) {
+            best = it;
+        }
+    }
+    return best;
+}
+
+void do_jobs ()
+{
+    std::unique_lock<std::mutex> lck(s_job_mutex);
+    while (true)
+    {
+        auto it = next_job();
+        if (it != s_jobs.end()) {
+            Job job = std::move(*it);
+            s_jobs.erase(it);
+            s_stream_busy[job.stream] = 1;
+            lck.unlock();
+
+            t_stream = job.stream;
+            job.f();
+
+            lck.lock();
+            s_stream_busy[job.stream] = 0;
+            s_unfinished.erase(job.id);
+            s_job_cond.notify_all();
+        } else if (s_finalizing && s_jobs.empty()) {
+            break;
+        } else {
+            s_job_cond.wait(lck);
+        }
+    }
+}
+
+Long s_max_staging = 0;
+Long s_staging_in_use = 0;
+StagingStats s_staging_stats;
+std::mutex s_staging_mutex;
+std::condition_variable s_staging_cond;
+
 }
 
 void Initialize ()
@@ -27,9 +105,13 @@ void Initialize ()
     ParmParse pp("amrex");
     pp.queryAdd("async_out", s_asyncout);
     pp.queryAdd("async_out_nfiles", s_noutfiles);
+    pp.queryAdd("async_out_nthreads", s_nthreads);
+    pp.queryAdd("async_out_max_staging", s_max_staging);
 
     int nprocs = ParallelDescriptor::NProcs();
     s_noutfiles = std::min(s_noutfiles, nprocs);
+    s_nthreads = std::max(s_nthreads, 1);
+    s_comm.resize(s_nthreads, MPI_COMM_NULL);
 
 #ifdef AMREX_USE_MPI
     if (s_asyncout && s_noutfiles < nprocs)
@@ -44,12 +126,21 @@ void Initialize ()
         }
         int myproc = ParallelDescriptor::MyProc();
         s_info = GetWriteInfo(myproc);
-        MPI_Comm_split(ParallelDescriptor::Communicator(), s_info.ifile, myproc, &s_comm);
+        // Each stream has its own communicator so that Wait and Notify
+        // of concurrent jobs cannot match each other.
+        MPI_Comm_split(ParallelDescriptor::Communicator(), s_info.ifile, myproc, &s_comm[0]);
+        for (int i = 1; i < s_nthreads; ++i) {
+            MPI_Comm_dup(s_comm[0], &s_comm[i]);
+        }
     }
 #endif
 
     if (s_asyncout) {
-        s_thread = std::make_unique<BackgroundThread>();
+        s_finalizing = false;
+        s_stream_busy.assign(s_nthreads, 0);
+        for (int i = 0; i < s_nthreads; ++i) {
+            s_threads.emplace_back(do_jobs);
+        }
     }
 
     ExecOnFinalize(Finalize);
@@ -57,13 +148,23 @@ void Initialize ()
 
 void Finalize ()
 {
-    if (s_thread) {
-        s_thread.reset();
+    if (!s_threads.empty()) {
+        {
+            std::lock_guard<std::mutex> lck(s_job_mutex);
+            s_finalizing = true;
+        }
+        s_job_cond.notify_all();
+        for (auto& t : s_threads) {
+            t.join();
+        }
+        s_threads.clear();
     }
 
 #ifdef AMREX_USE_MPI
-    if (s_comm != MPI_COMM_NULL) MPI_Comm_free(&s_comm);
-    s_comm = MPI_COMM_NULL;
+    for (auto& comm : s_comm) {
+        if (comm != MPI_COMM_NULL) MPI_Comm_free(&comm);
+        comm = MPI_COMM_NULL;
+    }
 #endif
 }
 
@@ -92,23 +193,60 @@ WriteInfo GetWriteInfo (int rank)
     return WriteInfo{ifile, ispot, nspots};
 }
 
-void Submit (std::function<void()>&& a_f)
+int NStreams () { return s_nthreads; }
+
+JobId Submit (std::function<void()>&& a_f)
 {
-    s_thread->Submit(std::move(a_f));
+    return Submit(std::move(a_f), s_current_stream, s_current_priority);
 }
 
-void Submit (std::function<void()> const& a_f)
+JobId Submit (std::function<void()> const& a_f)
 {
-    s_thread->Submit(a_f);
+    return Submit(std::function<void()>(a_f), s_current_stream, s_current_priority);
+}
+
+JobId Submit (std::function<void()>&& a_f, int stream, int priority,
+              Vector<JobId> const& deps)
+{
+    AMREX_ASSERT(!s_threads.empty());
+    std::lock_guard<std::mutex> lck(s_job_mutex);
+    JobId id = s_next_id++;
+    s_jobs.push_back(Job{id, stream % s_nthreads, priority, deps, std::move(a_f)});
+    s_unfinished.insert(id);
+    s_job_cond.notify_all();
+    return id;
 }
 
 void Finish ()
 {
-    if (s_thread) {
-        s_thread->Finish();
-    }
+    std::unique_lock<std::mutex> lck(s_job_mutex);
+    s_job_cond.wait(lck, [] () { return s_unfinished.empty(); });
+}
+
+void Finish (JobId id)
+{
+    std::unique_lock<std::mutex> lck(s_job_mutex);
+    s_job_cond.wait(lck, [=] () { return s_unfinished.count(id) == 0; });
+}
+
+ScopedStream::ScopedStream (int a_stream, int a_priority)
+    : m_prev_stream(s_current_stream),
+      m_prev_priority(s_current_priority)
+{
+    s_current_stream = a_stream;
+    s_current_priority = a_priority;
+}
+
+ScopedStream::~ScopedStream ()
+{
+    s_current_stream = m_prev_stream;
+    s_current_priority = m_prev_priority;
 }
 
+int CurrentStream () { return s_current_stream; }
+
+int CurrentPriority () { return s_current_priority; }
+
 void Wait ()
 {
 #ifdef AMREX_USE_MPI
@@ -117,7 +255,7 @@ void Wait ()
         Vector<MPI_Request> reqs(N);
         Vector<MPI_Status> stats(N);
         for (int i = 0; i < N; ++i) {
-            reqs[i] = ParallelDescriptor::Abarrier(s_comm).req();
+            reqs[i] = ParallelDescriptor::Abarrier(s_comm[t_stream]).req();
         }
         ParallelDescriptor::Waitall(reqs, stats);
     }
@@ -132,11 +270,61 @@ void Notify ()
         Vector<MPI_Request> reqs(N);
         Vector<MPI_Status> stats(N);
         for (int i = 0; i < N; ++i) {
-            reqs[i] = ParallelDescriptor::Abarrier(s_comm).req();
+            reqs[i] = ParallelDescriptor::Abarrier(s_comm[t_stream]).req();
         }
         ParallelDescriptor::Waitall(reqs, stats);
     }
 #endif
 }
 
+Long MaxStagingBytes ()
+{
+    return s_max_staging;
+}
+
+void SetMaxStagingBytes (Long nbytes)
+{
+    std::lock_guard<std::mutex> lck(s_staging_mutex);
+    s_max_staging = nbytes;
+}
+
+void AcquireStaging (Long nbytes)
+{
+    std::unique_lock<std::mutex> lck(s_staging_mutex);
+    // A request larger than the limit is allowed once nothing else is staged.
+    if (s_max_staging > 0 && s_staging_in_use > 0 && s_staging_in_use + nbytes > s_max_staging) {
+        double t0 = amrex::second();
+        s_staging_cond.wait(lck, [=] () {
+            return s_staging_in_use == 0 || s_staging_in_use + nbytes <= s_max_staging;
+        });
+        s_staging_stats.stall_time += amrex::second() - t0;
+    }
+    s_staging_in_use += nbytes;
+    s_staging_stats.nbytes += nbytes;
+    s_staging_stats.peak_bytes = std::max(s_staging_stats.peak_bytes, s_staging_in_use);
+}
+
+void ReleaseStaging (Long nbytes, double write_time)
+{
+    {
+        std::lock_guard<std::mutex> lck(s_staging_mutex);
+        s_staging_in_use -= nbytes;
+        ++s_staging_stats.nchunks;
+        s_staging_stats.write_time += write_time;
+    }
+    s_staging_cond.notify_all();
+}
+
+StagingStats GetStagingStats ()
+{
+    std::lock_guard<std::mutex> lck(s_staging_mutex);
+    return s_staging_stats;
+}
+
+void ResetStagingStats ()
+{
+    std::lock_guard<std::mutex> lck(s_staging_mutex);
+    s_staging_stats = StagingStats{};
+}
+
 }
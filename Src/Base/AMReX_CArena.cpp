@@ -3,6 +3,8 @@
 #include <AMReX_BLassert.H>
 #include <AMReX_Gpu.H>
 #include <AMReX_ParallelReduce.H>
+#include <AMReX_Algorithm.H>
+#include <AMReX_OpenMP.H>
 
 #ifdef AMREX_TINY_PROFILING
 #include <AMReX_TinyProfiler.H>
@@ -12,17 +14,61 @@ namespace amrex {
 }
 #endif
 
+#include <algorithm>
+#include <cstdint>
 #include <utility>
 #include <cstring>
 
 namespace amrex {
 
+namespace {
+
+    static_assert(Arena::align_size == 16, "The size classes of the per-thread caches assume 16-byte alignment");
+
+    // Size classes of the per-thread caches.  Up to 64 bytes, they are the
+    // multiples of 16.  Above that, there are four classes per power of
+    // two, so that at most 20% of a cached block is wasted.
+    int cache_size_class (std::size_t nbytes) noexcept
+    {
+        if (nbytes <= 64) {
+            return static_cast<int>((nbytes-1)/16);
+        } else {
+            const int p = 63 - amrex::clz(static_cast<std::uint64_t>(nbytes-1));
+            const std::size_t step = std::size_t(1) << (p-2);
+            return 4*(p-5) + static_cast<int>((nbytes+step-1)/step) - 5;
+        }
+    }
+
+    std::size_t cache_class_size (int sc) noexcept
+    {
+        if (sc < 4) {
+            return std::size_t(16)*(sc+1);
+        } else {
+            return std::size_t(sc%4 + 5) << (sc/4 + 3);
+        }
+    }
+}
+
 CArena::CArena (std::size_t hunk_size, ArenaInfo info)
     : m_hunk(align(hunk_size == 0 ? DefaultHunkSize : hunk_size))
 {
     arena_info = info;
     BL_ASSERT(m_hunk >= hunk_size);
     BL_ASSERT(m_hunk%Arena::align_size == 0);
+
+    if (info.thread_cache_max_block > 0 && info.thread_cache_capacity > 0 &&
+        OpenMP::get_max_threads() > 1)
+    {
+        m_cache_max_block = std::min(align(info.thread_cache_max_block), m_hunk);
+        m_cache_capacity = std::max(static_cast<std::size_t>(info.thread_cache_capacity),
+                                    m_cache_max_block);
+        const int nclasses = cache_size_class(m_cache_max_block) + 1;
+        m_thread_cache.resize(OpenMP::get_max_threads());
+        for (auto& tc : m_thread_cache) {
+            tc = std::make_unique<ThreadCache>();
+            tc->freelist.resize(nclasses);
+        }
+    }
 }
 
 CArena::~CArena ()
@@ -34,6 +80,9 @@ CArena::~CArena ()
 #ifdef AMREX_TINY_PROFILING
     if (m_do_profiling) {
         TinyProfiler::DeregisterArena(m_profiling_stats);
+        for (auto const& tc : m_thread_cache) {
+            TinyProfiler::DeregisterArena(tc->profiling_stats);
+        }
     }
 #endif
 }
@@ -41,10 +90,16 @@ CArena::~CArena ()
 void*
 CArena::alloc (std::size_t nbytes)
 {
-    std::lock_guard<std::mutex> lock(carena_mutex);
-
     nbytes = Arena::align(nbytes == 0 ? 1 : nbytes);
 
+    if (nbytes <= m_cache_max_block) {
+        if (auto* tc = thread_cache()) {
+            return cache_alloc(*tc, nbytes);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(carena_mutex);
+
     MemStat* stat = nullptr;
 #ifdef AMREX_TINY_PROFILING
     if (m_do_profiling) {
@@ -52,6 +107,15 @@ CArena::alloc (std::size_t nbytes)
     }
 #endif
 
+    Node node = alloc_protected(nbytes);
+    m_busylist.insert(Node(node.block(), node.owner(), nbytes, stat));
+
+    return node.block();
+}
+
+CArena::Node
+CArena::alloc_protected (std::size_t nbytes)
+{
     if (static_cast<Long>(m_used+nbytes) >= arena_info.release_threshold) {
         freeUnused_protected();
     }
@@ -68,12 +132,14 @@ CArena::alloc (std::size_t nbytes)
     }
 
     void* vp = nullptr;
+    void* owner = nullptr;
 
     if (free_it == m_freelist.end())
     {
         const std::size_t N = nbytes < m_hunk ? m_hunk : nbytes;
 
         vp = allocate_system(N);
+        owner = vp;
 
         m_used += N;
 
@@ -90,8 +156,6 @@ CArena::alloc (std::size_t nbytes)
 
             m_freelist.insert(m_freelist.end(), Node(block, vp, m_hunk-nbytes));
         }
-
-        m_busylist.insert(Node(vp, vp, nbytes, stat));
     }
     else
     {
@@ -99,7 +163,7 @@ CArena::alloc (std::size_t nbytes)
         BL_ASSERT(m_busylist.find(*free_it) == m_busylist.end());
 
         vp = (*free_it).block();
-        m_busylist.insert(Node(vp, free_it->owner(), nbytes, stat));
+        owner = free_it->owner();
 
         if ((*free_it).size() > nbytes)
         {
@@ -124,7 +188,7 @@ CArena::alloc (std::size_t nbytes)
 
     BL_ASSERT(vp != nullptr);
 
-    return vp;
+    return Node(vp, owner, nbytes);
 }
 
 void
@@ -137,6 +201,28 @@ CArena::free (void* vp)
         return;
     }
 
+    if (auto* tc = thread_cache()) {
+        std::vector<Node> evicted;
+        bool found = false;
+        {
+            std::lock_guard<std::mutex> tclock(tc->mutex);
+            auto it = tc->busylist.find(vp);
+            if (it != tc->busylist.end()) {
+                cache_free(*tc, it, evicted);
+                found = true;
+            }
+        }
+        if (found) {
+            if (!evicted.empty()) {
+                std::lock_guard<std::mutex> lock(carena_mutex);
+                for (auto const& node : evicted) {
+                    free_protected(node);
+                }
+            }
+            return;
+        }
+    }
+
     std::lock_guard<std::mutex> lock(carena_mutex);
 
     //
@@ -144,31 +230,58 @@ CArena::free (void* vp)
     //
     auto busy_it = m_busylist.find(Node(vp,nullptr,0));
     if (busy_it == m_busylist.end()) {
+        //
+        // Or it was given out by the cache of another thread.
+        //
+        for (auto const& tc : m_thread_cache) {
+            std::vector<Node> evicted;
+            bool found = false;
+            {
+                std::lock_guard<std::mutex> tclock(tc->mutex);
+                auto it = tc->busylist.find(vp);
+                if (it != tc->busylist.end()) {
+                    cache_free(*tc, it, evicted);
+                    found = true;
+                }
+            }
+            if (found) {
+                for (auto const& node : evicted) {
+                    free_protected(node);
+                }
+                return;
+            }
+        }
         amrex::Abort("CArena::free: unknown pointer");
         return;
     }
     BL_ASSERT(m_freelist.find(*busy_it) == m_freelist.end());
 
-    m_actually_used -= busy_it->size();
-
 #ifdef AMREX_TINY_PROFILING
     TinyProfiler::memory_free(busy_it->size(), busy_it->mem_stat());
 #endif
 
+    free_protected(*busy_it);
+    //
+    // And remove from busy list.
+    //
+    m_busylist.erase(busy_it);
+}
+
+void
+CArena::free_protected (const Node& node)
+{
+    m_actually_used -= node.size();
+
     //
     // Put free'd block on free list and save iterator to insert()ed position.
     //
-    std::pair<NL::iterator,bool> pair_it = m_freelist.insert(*busy_it);
+    std::pair<NL::iterator,bool> pair_it = m_freelist.insert(node);
 
     BL_ASSERT(pair_it.second == true);
 
     auto free_it = pair_it.first;
 
-    BL_ASSERT(free_it != m_freelist.end() && (*free_it).block() == (*busy_it).block());
-    //
-    // And remove from busy list.
-    //
-    m_busylist.erase(busy_it);
+    BL_ASSERT(free_it != m_freelist.end() && (*free_it).block() == node.block());
     //
     // Coalesce freeblock(s) on lo and hi side of this block.
     //
@@ -193,9 +306,9 @@ CArena::free (void* vp)
             // then reinsert it with a different size() as it'll just go
             // back into the same place in the set.
             //
-            Node* node = const_cast<Node*>(&(*lo_it));
-            BL_ASSERT(node != nullptr);
-            node->size((*lo_it).size() + (*free_it).size());
+            Node* fnode = const_cast<Node*>(&(*lo_it));
+            BL_ASSERT(fnode != nullptr);
+            fnode->size((*lo_it).size() + (*free_it).size());
             m_freelist.erase(free_it);
             free_it = lo_it;
         }
@@ -210,13 +323,115 @@ CArena::free (void* vp)
         //
         // Ditto the above comment.
         //
-        Node* node = const_cast<Node*>(&(*free_it));
-        BL_ASSERT(node != nullptr);
-        node->size((*free_it).size() + (*hi_it).size());
+        Node* fnode = const_cast<Node*>(&(*free_it));
+        BL_ASSERT(fnode != nullptr);
+        fnode->size((*free_it).size() + (*hi_it).size());
         m_freelist.erase(hi_it);
     }
 }
 
+CArena::ThreadCache*
+CArena::thread_cache () noexcept
+{
+    if (!m_thread_cache.empty() && OpenMP::in_parallel()) {
+        auto tid = static_cast<std::size_t>(OpenMP::get_thread_num());
+        if (tid < m_thread_cache.size()) {
+            return m_thread_cache[tid].get();
+        }
+    }
+    return nullptr;
+}
+
+void*
+CArena::cache_alloc (ThreadCache& tc, std::size_t nbytes)
+{
+    const int sc = cache_size_class(nbytes);
+    const std::size_t sz = cache_class_size(sc);
+
+    {
+        std::lock_guard<std::mutex> tclock(tc.mutex);
+        auto& fl = tc.freelist[sc];
+        if (!fl.empty()) {
+            auto [vp, owner] = fl.back();
+            fl.pop_back();
+            tc.idle -= sz;
+            ++tc.nhit;
+            MemStat* stat = nullptr;
+#ifdef AMREX_TINY_PROFILING
+            if (m_do_profiling) {
+                stat = TinyProfiler::memory_alloc(sz, tc.profiling_stats);
+                ++stat->ncached;
+            }
+#endif
+            tc.busylist.emplace(vp, CachedBlock{owner, stat, sc});
+            return vp;
+        }
+    }
+
+    //
+    // Refill the cache with a few blocks carved out of one chunk, so that
+    // the cost of taking the lock of the arena is amortized.
+    //
+    const std::size_t nblocks = std::max(std::size_t(1),
+                                         std::min({std::size_t(16),
+                                                   std::size_t(64*1024) / sz,
+                                                   m_cache_capacity / (2*sz)}));
+    Node chunk = [&] () {
+        std::lock_guard<std::mutex> lock(carena_mutex);
+        return alloc_protected(nblocks*sz);
+    }();
+
+    std::lock_guard<std::mutex> tclock(tc.mutex);
+    ++tc.nmiss;
+    auto* p = static_cast<char*>(chunk.block());
+    auto& fl = tc.freelist[sc];
+    for (std::size_t n = nblocks-1; n > 0; --n) {
+        fl.emplace_back(p + n*sz, chunk.owner());
+    }
+    tc.idle += (nblocks-1)*sz;
+    MemStat* stat = nullptr;
+#ifdef AMREX_TINY_PROFILING
+    if (m_do_profiling) {
+        stat = TinyProfiler::memory_alloc(sz, tc.profiling_stats);
+    }
+#endif
+    tc.busylist.emplace(p, CachedBlock{chunk.owner(), stat, sc});
+    return p;
+}
+
+void
+CArena::cache_free (ThreadCache& tc, std::unordered_map<void*,CachedBlock>::iterator it,
+                    std::vector<Node>& evicted)
+{
+    const int sc = it->second.size_class;
+    const std::size_t sz = cache_class_size(sc);
+#ifdef AMREX_TINY_PROFILING
+    TinyProfiler::memory_free(sz, it->second.stat);
+#endif
+    tc.freelist[sc].emplace_back(it->first, it->second.owner);
+    tc.idle += sz;
+    tc.busylist.erase(it);
+    if (tc.idle > m_cache_capacity) {
+        cache_evict(tc, m_cache_capacity/2, evicted);
+    }
+}
+
+void
+CArena::cache_evict (ThreadCache& tc, std::size_t target, std::vector<Node>& evicted)
+{
+    // Start with the largest blocks.
+    for (int sc = static_cast<int>(tc.freelist.size())-1; sc >= 0 && tc.idle > target; --sc) {
+        const std::size_t sz = cache_class_size(sc);
+        auto& fl = tc.freelist[sc];
+        while (!fl.empty() && tc.idle > target) {
+            evicted.emplace_back(fl.back().first, fl.back().second, sz);
+            fl.pop_back();
+            tc.idle -= sz;
+            ++tc.nflush;
+        }
+    }
+}
+
 std::size_t
 CArena::freeUnused ()
 {
@@ -227,6 +442,20 @@ CArena::freeUnused ()
 std::size_t
 CArena::freeUnused_protected ()
 {
+    //
+    // Idle blocks in the per-thread caches would pin their hunks.
+    //
+    for (auto const& tc : m_thread_cache) {
+        std::vector<Node> evicted;
+        {
+            std::lock_guard<std::mutex> tclock(tc->mutex);
+            cache_evict(*tc, 0, evicted);
+        }
+        for (auto const& node : evicted) {
+            free_protected(node);
+        }
+    }
+
     std::size_t nbytes = 0;
     m_alloc.erase(std::remove_if(m_alloc.begin(), m_alloc.end(),
                                  [&nbytes,this] (std::pair<void*,std::size_t> a)
@@ -294,6 +523,11 @@ CArena::registerForProfiling ([[maybe_unused]] const std::string& memory_name)
 #ifdef AMREX_TINY_PROFILING
     m_do_profiling = true;
     TinyProfiler::RegisterArena(memory_name, m_profiling_stats);
+    // The per-thread caches keep their own stats, which are combined with
+    // those of the arena in the report.
+    for (auto const& tc : m_thread_cache) {
+        TinyProfiler::RegisterArena(memory_name, tc->profiling_stats);
+    }
 #endif
 }
 
@@ -309,6 +543,16 @@ CArena::heap_space_actually_used () const noexcept
     return m_actually_used;
 }
 
+std::size_t
+CArena::heap_space_cached () const noexcept
+{
+    std::size_t r = 0;
+    for (auto const& tc : m_thread_cache) {
+        r += tc->idle;
+    }
+    return r;
+}
+
 std::size_t
 CArena::sizeOf (void* p) const noexcept
 {
@@ -317,6 +561,13 @@ CArena::sizeOf (void* p) const noexcept
     } else {
         auto it = m_busylist.find(Node(p,nullptr,0));
         if (it == m_busylist.end()) {
+            for (auto const& tc : m_thread_cache) {
+                std::lock_guard<std::mutex> tclock(tc->mutex);
+                auto cit = tc->busylist.find(p);
+                if (cit != tc->busylist.end()) {
+                    return cache_class_size(cit->second.size_class);
+                }
+            }
             return 0;
         } else {
             return it->size();
@@ -345,6 +596,17 @@ CArena::PrintUsage (std::string const& name) const
     amrex::Print() << "[" << name << "] space allocated (MB): " << min_megabytes << "\n";
     amrex::Print() << "[" << name << "] space used      (MB): " << actual_min_megabytes << "\n";
 #endif
+    if (!m_thread_cache.empty()) {
+        Long nhit = 0, nmiss = 0, nflush = 0;
+        for (auto const& tc : m_thread_cache) {
+            nhit += tc->nhit;
+            nmiss += tc->nmiss;
+            nflush += tc->nflush;
+        }
+        ParallelReduce::Sum<Long>({nhit, nmiss, nflush}, IOProc, ParallelDescriptor::Communicator());
+        amrex::Print() << "[" << name << "] thread caches: " << nhit << " hits, "
+                       << nmiss << " misses, " << nflush << " blocks flushed\n";
+    }
 }
 
 void
@@ -356,6 +618,17 @@ CArena::PrintUsage (std::ostream& os, std::string const& name, std::string const
     os << space << "[" << name << "] space used      (MB): " << actual_megabytes << "\n";
     os << space << "[" << name << "]: " << m_alloc.size() << " allocs, "
        << m_busylist.size() << " busy blocks, " << m_freelist.size() << " free blocks\n";
+    if (!m_thread_cache.empty()) {
+        Long nhit = 0, nmiss = 0, nflush = 0;
+        for (auto const& tc : m_thread_cache) {
+            nhit += tc->nhit;
+            nmiss += tc->nmiss;
+            nflush += tc->nflush;
+        }
+        os << space << "[" << name << "] thread caches: " << heap_space_cached()/(1024*1024)
+           << " MB idle, " << nhit << " hits, " << nmiss << " misses, "
+           << nflush << " blocks flushed\n";
+    }
 }
 
 }
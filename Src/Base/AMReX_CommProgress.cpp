@@ -0,0 +1,148 @@
+#include <AMReX_CommProgress.H>
+#include <AMReX_BackgroundThread.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX.H>
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace amrex::CommProgress {
+
+namespace {
+
+bool s_progress_thread = false;
+int s_poll_interval = 10; // in microseconds
+
+std::unique_ptr<BackgroundThread> s_thread;
+
+std::mutex s_mutex;
+std::condition_variable s_cond;
+bool s_stop = false;
+bool s_polling = false; // Is the progress thread polling outside the lock?
+int s_next_id = 0;
+std::map<int,std::vector<std::pair<MPI_Request*,int>>> s_reqs;
+
+#ifdef AMREX_USE_MPI
+void poll ()
+{
+    std::vector<MPI_Request> reqs;
+    std::unique_lock<std::mutex> lck(s_mutex);
+    while (true) {
+        s_cond.wait(lck, [] () -> bool { return s_stop || !s_reqs.empty(); });
+        if (s_stop) { break; }
+
+        reqs.clear();
+        for (auto const& kv : s_reqs) {
+            for (auto const& [p, n] : kv.second) {
+                for (int i = 0; i < n; ++i) {
+                    if (p[i] != MPI_REQUEST_NULL) { reqs.push_back(p[i]); }
+                }
+            }
+        }
+
+        // No MPI calls while holding the lock.  The requests stay valid
+        // until s_polling is reset, because Unregister waits for that.
+        s_polling = true;
+        lck.unlock();
+
+        for (auto const& r : reqs) {
+            int flag;
+            MPI_Request_get_status(r, &flag, MPI_STATUS_IGNORE);
+        }
+
+        lck.lock();
+        s_polling = false;
+        s_cond.notify_all();
+        lck.unlock();
+
+        if (s_poll_interval > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(s_poll_interval));
+        } else {
+            std::this_thread::yield();
+        }
+        lck.lock();
+    }
+}
+#endif
+
+}
+
+void Initialize ()
+{
+    ParmParse pp("amrex");
+    pp.queryAdd("comm_progress_thread", s_progress_thread);
+    pp.queryAdd("comm_progress_interval", s_poll_interval);
+
+#ifdef AMREX_USE_MPI
+    if (s_progress_thread && ParallelDescriptor::NProcs() > 1)
+    {
+        int provided = -1;
+        MPI_Query_thread(&provided);
+        if (provided < MPI_THREAD_MULTIPLE) {
+            amrex::Abort("amrex.comm_progress_thread requires MPI_THREAD_MULTIPLE at runtime, but got "
+                         + ParallelDescriptor::mpi_level_to_string(provided));
+        }
+        s_stop = false;
+        s_thread = std::make_unique<BackgroundThread>();
+        s_thread->Submit(poll);
+    }
+#endif
+
+    ExecOnFinalize(Finalize);
+}
+
+void Finalize ()
+{
+    if (s_thread) {
+        {
+            std::lock_guard<std::mutex> lck(s_mutex);
+            s_stop = true;
+            s_reqs.clear();
+        }
+        s_cond.notify_all();
+        s_thread.reset();
+    }
+}
+
+bool Active () noexcept
+{
+    return s_thread != nullptr;
+}
+
+int Register (std::vector<std::pair<MPI_Request*,int>> const& reqs)
+{
+    if (!s_thread) { return -1; }
+
+    bool has_reqs = false;
+    for (auto const& r : reqs) {
+        if (r.second > 0) { has_reqs = true; }
+    }
+    if (!has_reqs) { return -1; }
+
+    int id;
+    {
+        std::lock_guard<std::mutex> lck(s_mutex);
+        id = s_next_id++;
+        s_reqs.emplace(id, reqs);
+    }
+    s_cond.notify_all();
+    return id;
+}
+
+void Unregister (int& id)
+{
+    if (id >= 0) {
+        std::unique_lock<std::mutex> lck(s_mutex);
+        s_reqs.erase(id);
+        // The progress thread may be polling a copy of the handles.
+        s_cond.wait(lck, [] () -> bool { return !s_polling; });
+    }
+    id = -1;
+}
+
+}
@@ -23,6 +23,10 @@
 #endif
 
 #include <algorithm>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
 #include <utility>
 
 namespace amrex {
@@ -60,6 +64,14 @@ IntVect FabArrayBase::comm_tile_size(AMREX_D_DECL(1024000, 1024000, 1024000));
 IntVect FabArrayBase::comm_tile_size(AMREX_D_DECL(1024000, 8, 8));
 #endif
 
+Long        FabArrayBase::fb_cache_max_bytes;
+Long        FabArrayBase::cpc_cache_max_bytes;
+std::string FabArrayBase::comm_cache_dir;
+Long        FabArrayBase::comm_cache_max_file_bytes = 256*1024*1024;
+bool        FabArrayBase::node_shared;
+bool        FabArrayBase::persistent_comm;
+bool        FabArrayBase::neighbor_collective;
+
 FabArrayBase::TACache              FabArrayBase::m_TheTileArrayCache;
 FabArrayBase::FBCache              FabArrayBase::m_TheFBCache;
 FabArrayBase::CPCache              FabArrayBase::m_TheCPCache;
@@ -80,6 +92,7 @@ FabArrayBase::CacheStats           FabArrayBase::m_FPinfo_stats("FillPatchCache"
 FabArrayBase::CacheStats           FabArrayBase::m_CFinfo_stats("CrseFineCache");
 
 std::map<FabArrayBase::BDKey, int> FabArrayBase::m_BD_count;
+Long                               FabArrayBase::m_comm_cache_tick = 0;
 
 FabArrayBase::FabArrayStats        FabArrayBase::m_FA_stats;
 
@@ -89,6 +102,173 @@ std::vector<std::string>                    FabArrayBase::m_region_tag;
 namespace
 {
     bool initialized = false;
+
+    // NodeInfo of each communicator that node-shared FabArrays have been
+    // built on, and the maximum number of processes in a node-shared group.
+    std::map<MPI_Comm,FabArrayBase::NodeInfo> node_info_cache;
+    int node_shared_group_size = 0;
+
+    // Duplicates of the communicators used by persistent requests
+    std::map<MPI_Comm,MPI_Comm> persistent_comm_cache;
+
+    //
+    // On-disk store of FB and CPC metadata.  Each process owns one file
+    // that is a sequence of records, each starting with a magic number,
+    // the hash key and the full layout the metadata were built for.  The
+    // layout is compared on reading, so a hash collision or a changed
+    // DistributionMapping never returns wrong tags.  The index from key to
+    // file offset is built by scanning the file the first time it is
+    // needed.  The scan stops at the first incomplete or damaged record,
+    // and new records are written from there on, so that they can be found
+    // by the next run.  When the file would grow beyond
+    // comm_cache_max_file_bytes, it is started over.
+    //
+    constexpr std::uint64_t comm_cache_magic = 0x414d52584d444332ULL; // "AMRXMDC2"
+
+    struct CommCacheFile
+    {
+        bool indexed = false;
+        std::string filename;
+        std::map<std::uint64_t,std::streamoff> index;
+        std::streamoff size = 0;
+    };
+
+    CommCacheFile comm_cache_file;
+
+    template <typename T>
+    void ccf_write (std::ostream& os, const T& v)
+    {
+        os.write(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    template <typename T>
+    bool ccf_read (std::istream& is, T& v)
+    {
+        is.read(reinterpret_cast<char*>(&v), sizeof(T));
+        return bool(is);
+    }
+
+    bool ccf_read_bytes (std::istream& is, std::string& v, std::uint64_t n)
+    {
+        v.resize(n);
+        is.read(v.data(), static_cast<std::streamsize>(n));
+        return bool(is);
+    }
+
+    void ccf_write_tags (std::ostream& os, const FabArrayBase::CopyComTagsContainer& tags)
+    {
+        ccf_write(os, static_cast<std::uint64_t>(tags.size()));
+        os.write(reinterpret_cast<const char*>(tags.data()),
+                 static_cast<std::streamsize>(tags.size()*sizeof(FabArrayBase::CopyComTag)));
+    }
+
+    bool ccf_read_tags (std::istream& is, FabArrayBase::CopyComTagsContainer& tags)
+    {
+        std::uint64_t n = 0;
+        if (!ccf_read(is, n)) { return false; }
+        tags.resize(n);
+        is.read(reinterpret_cast<char*>(tags.data()),
+                static_cast<std::streamsize>(n*sizeof(FabArrayBase::CopyComTag)));
+        return bool(is);
+    }
+
+    void ccf_write_map (std::ostream& os, const FabArrayBase::MapOfCopyComTagContainers& m)
+    {
+        ccf_write(os, static_cast<std::uint64_t>(m.size()));
+        for (auto const& kv : m) {
+            ccf_write(os, kv.first);
+            ccf_write_tags(os, kv.second);
+        }
+    }
+
+    bool ccf_read_map (std::istream& is, FabArrayBase::MapOfCopyComTagContainers& m)
+    {
+        std::uint64_t n = 0;
+        if (!ccf_read(is, n)) { return false; }
+        for (std::uint64_t i = 0; i < n; ++i) {
+            int rank = 0;
+            if (!ccf_read(is, rank) || !ccf_read_tags(is, m[rank])) { return false; }
+        }
+        return true;
+    }
+
+    void ccf_build_index ()
+    {
+        auto& ccf = comm_cache_file;
+        if (ccf.indexed) { return; }
+        ccf.indexed = true;
+        ccf.filename = FabArrayBase::comm_cache_dir + "/CommMetaData_"
+            + std::to_string(ParallelDescriptor::MyProc());
+        std::ifstream ifs(ccf.filename, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!ifs.good()) { return; }
+        const std::streamoff file_size = ifs.tellg();
+        ifs.seekg(0, std::ios::beg);
+        while (true) {
+            std::streamoff pos = ifs.tellg();
+            std::uint64_t magic = 0, key = 0, nbytes = 0;
+            if (!ccf_read(ifs, magic) || magic != comm_cache_magic ||
+                !ccf_read(ifs, key)   || !ccf_read(ifs, nbytes) ||
+                nbytes > static_cast<std::uint64_t>(file_size - ifs.tellg())) {
+                break; // Incomplete or damaged records are ignored.
+            }
+            ifs.seekg(static_cast<std::streamoff>(nbytes), std::ios::cur);
+            if (!ifs.good()) { break; }
+            ccf.index[key] = pos;
+            ccf.size = ifs.tellg();
+        }
+    }
+
+    //
+    // The layout is a byte string of everything the metadata depend on.
+    //
+    template <typename T>
+    void comm_cache_layout_add (std::string& layout, const T& v)
+    {
+        layout.append(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    void comm_cache_layout_add (std::string& layout, const IntVect& iv)
+    {
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+            comm_cache_layout_add(layout, iv[idim]);
+        }
+    }
+
+    void comm_cache_layout_add (std::string& layout, const Periodicity& period)
+    {
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+            comm_cache_layout_add(layout, period.isPeriodic(idim) ? period.Domain().length(idim) : 0);
+        }
+    }
+
+    void comm_cache_layout_add (std::string& layout, const BoxArray& ba,
+                                const DistributionMapping& dm)
+    {
+        comm_cache_layout_add(layout, ba.ixType().toIntVect());
+        comm_cache_layout_add(layout, ba.crseRatio());
+        comm_cache_layout_add(layout, ba.size());
+        for (int i = 0, N = static_cast<int>(ba.size()); i < N; ++i) {
+            const Box& b = ba[i];
+            comm_cache_layout_add(layout, b.smallEnd());
+            comm_cache_layout_add(layout, b.bigEnd());
+            comm_cache_layout_add(layout, dm[i]);
+        }
+    }
+
+    //! The parts of the layout that affect all metadata built by this process.
+    std::string comm_cache_layout_seed (const char* kind)
+    {
+        std::string layout(kind);
+        comm_cache_layout_add(layout, ParallelDescriptor::NProcs());
+        comm_cache_layout_add(layout, ParallelDescriptor::MyProc());
+        comm_cache_layout_add(layout, ParallelDescriptor::TeamSize());
+#if defined(AMREX_USE_OMP)
+        comm_cache_layout_add(layout, omp_get_max_threads() > 1);
+#endif
+        comm_cache_layout_add(layout, static_cast<int>(sizeof(FabArrayBase::CopyComTag)));
+        comm_cache_layout_add(layout, FabArrayBase::comm_tile_size);
+        return layout;
+    }
 }
 
 void
@@ -122,6 +302,25 @@ FabArrayBase::Initialize ()
         MaxComp = 1;
     }
 
+    FabArrayBase::fb_cache_max_bytes  = -1;
+    FabArrayBase::cpc_cache_max_bytes = -1;
+    FabArrayBase::comm_cache_dir.clear();
+    FabArrayBase::comm_cache_max_file_bytes = 256*1024*1024;
+    pp.queryAdd("fb_cache_max_bytes",  FabArrayBase::fb_cache_max_bytes);
+    pp.queryAdd("cpc_cache_max_bytes", FabArrayBase::cpc_cache_max_bytes);
+    pp.queryAdd("comm_cache_dir",      FabArrayBase::comm_cache_dir);
+    pp.queryAdd("comm_cache_max_file_bytes", FabArrayBase::comm_cache_max_file_bytes);
+
+    FabArrayBase::node_shared = false;
+    node_shared_group_size = 0;
+    pp.queryAdd("node_shared",            FabArrayBase::node_shared);
+    pp.queryAdd("node_shared_group_size", node_shared_group_size);
+
+    FabArrayBase::persistent_comm = false;
+    FabArrayBase::neighbor_collective = false;
+    pp.queryAdd("persistent_comm",     FabArrayBase::persistent_comm);
+    pp.queryAdd("neighbor_collective", FabArrayBase::neighbor_collective);
+
     amrex::ExecOnFinalize(FabArrayBase::Finalize);
 
 #ifdef AMREX_MEM_PROFILING
@@ -285,8 +484,29 @@ FabArrayBase::CPC::CPC (const FabArrayBase& dstfa, const IntVect& dstng,
       m_srcba(srcfa.boxArray()),
       m_dstba(dstfa.boxArray())
 {
+    const bool use_disk_cache = !comm_cache_dir.empty() &&
+        !(dstfa.IndexArray().empty() && srcfa.IndexArray().empty());
+    std::string layout;
+    if (use_disk_cache) {
+        layout = comm_cache_layout_seed("CPC");
+        comm_cache_layout_add(layout, m_dstba, dstfa.DistributionMap());
+        comm_cache_layout_add(layout, m_srcba, srcfa.DistributionMap());
+        comm_cache_layout_add(layout, m_dstng);
+        comm_cache_layout_add(layout, m_srcng);
+        comm_cache_layout_add(layout, m_period);
+        comm_cache_layout_add(layout, m_tgco);
+        if (readCommMetaData(layout, *this)) {
+            m_CPC_stats.recordLoad();
+            return;
+        }
+    }
+
     this->define(m_dstba, dstfa.DistributionMap(), dstfa.IndexArray(),
                  m_srcba, srcfa.DistributionMap(), srcfa.IndexArray());
+
+    if (use_disk_cache) {
+        writeCommMetaData(layout, *this);
+    }
 }
 
 FabArrayBase::CPC::CPC (const BoxArray& dstba, const DistributionMapping& dstdm,
@@ -520,9 +740,7 @@ FabArrayBase::flushCPC (bool no_assertion) const
             }
         }
 
-#ifdef AMREX_MEM_PROFILING
-        m_CPC_stats.bytes -= it->second->bytes();
-#endif
+        m_CPC_stats.bytes -= it->second->m_bytes;
         m_CPC_stats.recordErase(it->second->m_nuse);
         delete it->second;
     }
@@ -549,9 +767,61 @@ FabArrayBase::flushCPCache ()
         delete c;
     }
     m_TheCPCache.clear();
-#ifdef AMREX_MEM_PROFILING
     m_CPC_stats.bytes = 0L;
-#endif
+}
+
+int
+FabArrayBase::numCommCacheEvictions (Vector<const CommMetaData*>& lru, Long bytes, Long max_bytes)
+{
+    std::sort(lru.begin(), lru.end(), [] (const CommMetaData* a, const CommMetaData* b)
+              { return a->m_last_use < b->m_last_use; });
+    int nevict = 0;
+    const int nlru = static_cast<int>(lru.size());
+    while (bytes > max_bytes && nevict < nlru) {
+        bytes -= lru[nevict++]->m_bytes;
+    }
+    if (neighbor_collective) {
+        // Freeing the neighborhood communicators is collective.  Because
+        // the caches are only changed by collective calls, all processes
+        // have the same entries in the same LRU order, so they only need
+        // to agree on the number of entries to evict.
+        ParallelAllReduce::Max(nevict, ParallelContext::CommunicatorSub());
+        nevict = std::min(nevict, nlru);
+    }
+    return nevict;
+}
+
+void
+FabArrayBase::pruneCPCache ()
+{
+    if (cpc_cache_max_bytes < 0) { return; }
+
+    // Each CPC is visited once through its source key.
+    Vector<const CommMetaData*> lru;
+    for (auto const& kv : m_TheCPCache) {
+        if (kv.first == kv.second->m_srcbdk && kv.second->m_npinned == 0) {
+            lru.push_back(kv.second);
+        }
+    }
+    const int nevict = numCommCacheEvictions(lru, m_CPC_stats.bytes, cpc_cache_max_bytes);
+
+    for (int i = 0; i < nevict; ++i)
+    {
+        auto* cpc = static_cast<CPC*>(const_cast<CommMetaData*>(lru[i]));
+        for (const BDKey& key : {cpc->m_srcbdk, cpc->m_dstbdk}) {
+            auto er_it = m_TheCPCache.equal_range(key);
+            for (auto it = er_it.first; it != er_it.second; ++it) {
+                if (it->second == cpc) {
+                    m_TheCPCache.erase(it);
+                    break;
+                }
+            }
+        }
+
+        m_CPC_stats.bytes -= cpc->m_bytes;
+        m_CPC_stats.recordEvict(cpc->m_nuse);
+        delete cpc;
+    }
 }
 
 const FabArrayBase::CPC&
@@ -581,6 +851,7 @@ FabArrayBase::getCPC (const IntVect& dstng, const FabArrayBase& src, const IntVe
             it->second->m_dstba  == boxArray())
         {
             ++(it->second->m_nuse);
+            it->second->m_last_use = ++m_comm_cache_tick;
             m_CPC_stats.recordUse();
             return *(it->second);
         }
@@ -589,16 +860,19 @@ FabArrayBase::getCPC (const IntVect& dstng, const FabArrayBase& src, const IntVe
     // Have to build a new one
     CPC* new_cpc = new CPC(*this, dstng, src, srcng, period, to_ghost_cells_only);
 
-#ifdef AMREX_MEM_PROFILING
-    m_CPC_stats.bytes += new_cpc->bytes();
+    new_cpc->m_bytes = new_cpc->bytes();
+    m_CPC_stats.bytes += new_cpc->m_bytes;
     m_CPC_stats.bytes_hwm = std::max(m_CPC_stats.bytes_hwm, m_CPC_stats.bytes);
-#endif
 
     new_cpc->m_nuse = 1;
+    new_cpc->m_last_use = ++m_comm_cache_tick;
     m_CPC_stats.recordBuild();
     m_CPC_stats.recordUse();
 
-    m_TheCPCache.insert(er_it.second, CPCache::value_type(dstkey,new_cpc));
+    // The new one is not in the cache yet and therefore will not be evicted.
+    pruneCPCache();
+
+    m_TheCPCache.insert(CPCache::value_type(dstkey,new_cpc));
     if (srckey != dstkey) {
         m_TheCPCache.insert(          CPCache::value_type(srckey,new_cpc));
     }
@@ -606,6 +880,104 @@ FabArrayBase::getCPC (const IntVect& dstng, const FabArrayBase& src, const IntVe
     return *new_cpc;
 }
 
+void
+FabArrayBase::writeCommMetaData (const std::string& layout, const CommMetaData& cmd)
+{
+    BL_PROFILE("FabArrayBase::writeCommMetaData()");
+
+    ccf_build_index();
+    auto& ccf = comm_cache_file;
+    const std::uint64_t key = std::hash<std::string>{}(layout);
+    if (ccf.index.count(key) > 0) { return; }
+
+    std::ostringstream body;
+    ccf_write(body, static_cast<std::uint64_t>(layout.size()));
+    body.write(layout.data(), static_cast<std::streamsize>(layout.size()));
+    ccf_write(body, static_cast<char>(cmd.m_threadsafe_loc));
+    ccf_write(body, static_cast<char>(cmd.m_threadsafe_rcv));
+    ccf_write_tags(body, *cmd.m_LocTags);
+    ccf_write_map(body, *cmd.m_SndTags);
+    ccf_write_map(body, *cmd.m_RcvTags);
+    const std::string& buf = body.str();
+
+    if (!amrex::UtilCreateDirectory(comm_cache_dir, 0755)) {
+        amrex::CreateDirectoryFailed(comm_cache_dir);
+    }
+    const auto nbytes = static_cast<std::streamoff>(3*sizeof(std::uint64_t) + buf.size());
+    if (comm_cache_max_file_bytes >= 0 && nbytes > comm_cache_max_file_bytes) { return; }
+    auto mode = std::ios::out | std::ios::binary;
+    if (comm_cache_max_file_bytes >= 0 && ccf.size + nbytes > comm_cache_max_file_bytes) {
+        // Start over instead of growing without bound.
+        mode |= std::ios::trunc;
+        ccf.index.clear();
+        ccf.size = 0;
+    } else if (ccf.size == 0) {
+        // There are no complete records to keep.
+        mode |= std::ios::trunc;
+    } else {
+        // Overwrite anything after the last complete record.
+        mode |= std::ios::in;
+    }
+    std::ofstream ofs(ccf.filename, mode);
+    if (!ofs.good()) {
+        amrex::FileOpenFailed(ccf.filename);
+    }
+    ofs.seekp(ccf.size, std::ios::beg);
+    std::streamoff pos = ofs.tellp();
+    ccf_write(ofs, comm_cache_magic);
+    ccf_write(ofs, key);
+    ccf_write(ofs, static_cast<std::uint64_t>(buf.size()));
+    ofs.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    ofs.flush();
+    if (ofs.good()) {
+        ccf.index[key] = pos;
+        ccf.size = pos + nbytes;
+    }
+}
+
+bool
+FabArrayBase::readCommMetaData (const std::string& layout, CommMetaData& cmd)
+{
+    BL_PROFILE("FabArrayBase::readCommMetaData()");
+
+    ccf_build_index();
+    auto& ccf = comm_cache_file;
+    const std::uint64_t key = std::hash<std::string>{}(layout);
+    auto found = ccf.index.find(key);
+    if (found == ccf.index.end()) { return false; }
+
+    std::ifstream ifs(ccf.filename, std::ios::in | std::ios::binary);
+    ifs.seekg(found->second);
+
+    std::uint64_t magic = 0, rkey = 0, nbytes = 0, nlayout = 0;
+    std::string rlayout;
+    char tsloc = 0, tsrcv = 0;
+    auto loc_tags = std::make_unique<CopyComTagsContainer>();
+    auto snd_tags = std::make_unique<MapOfCopyComTagContainers>();
+    auto rcv_tags = std::make_unique<MapOfCopyComTagContainers>();
+    if (ccf_read(ifs, magic) && magic == comm_cache_magic &&
+        ccf_read(ifs, rkey)  && rkey == key && ccf_read(ifs, nbytes) &&
+        ccf_read(ifs, nlayout) && nlayout == layout.size() &&
+        ccf_read_bytes(ifs, rlayout, nlayout) && rlayout == layout &&
+        ccf_read(ifs, tsloc) && ccf_read(ifs, tsrcv) &&
+        ccf_read_tags(ifs, *loc_tags) &&
+        ccf_read_map(ifs, *snd_tags) &&
+        ccf_read_map(ifs, *rcv_tags))
+    {
+        cmd.m_threadsafe_loc = tsloc;
+        cmd.m_threadsafe_rcv = tsrcv;
+        cmd.m_LocTags = std::move(loc_tags);
+        cmd.m_SndTags = std::move(snd_tags);
+        cmd.m_RcvTags = std::move(rcv_tags);
+        return true;
+    }
+    else
+    {
+        ccf.index.erase(found);
+        return false;
+    }
+}
+
 //
 // Some stuff for fill boundary
 //
@@ -626,6 +998,23 @@ FabArrayBase::FB::FB (const FabArrayBase& fa, const IntVect& nghost,
     m_RcvTags = std::make_unique<CopyComTag::MapOfCopyComTagContainers>();
 
     if (!fa.IndexArray().empty()) {
+        const bool use_disk_cache = !comm_cache_dir.empty();
+        std::string layout;
+        if (use_disk_cache) {
+            layout = comm_cache_layout_seed("FB");
+            comm_cache_layout_add(layout, fa.boxArray(), fa.DistributionMap());
+            comm_cache_layout_add(layout, m_ngrow);
+            comm_cache_layout_add(layout, m_period);
+            comm_cache_layout_add(layout, m_cross);
+            comm_cache_layout_add(layout, m_epo);
+            comm_cache_layout_add(layout, m_override_sync);
+            comm_cache_layout_add(layout, m_multi_ghost);
+            if (readCommMetaData(layout, *this)) {
+                m_FBC_stats.recordLoad();
+                return;
+            }
+        }
+
         if (enforce_periodicity_only) {
             BL_ASSERT(m_cross==false);
             define_epo(fa);
@@ -635,6 +1024,10 @@ FabArrayBase::FB::FB (const FabArrayBase& fa, const IntVect& nghost,
         } else {
             define_fb(fa);
         }
+
+        if (use_disk_cache) {
+            writeCommMetaData(layout, *this);
+        }
     }
 }
 
@@ -1171,9 +1564,7 @@ FabArrayBase::flushFB (bool no_assertion) const
     std::pair<FBCacheIter,FBCacheIter> er_it = m_TheFBCache.equal_range(m_bdkey);
     for (auto it = er_it.first; it != er_it.second; ++it)
     {
-#ifdef AMREX_MEM_PROFILING
-        m_FBC_stats.bytes -= it->second->bytes();
-#endif
+        m_FBC_stats.bytes -= it->second->m_bytes;
         m_FBC_stats.recordErase(it->second->m_nuse);
         delete it->second;
     }
@@ -1189,9 +1580,36 @@ FabArrayBase::flushFBCache ()
         delete it.second;
     }
     m_TheFBCache.clear();
-#ifdef AMREX_MEM_PROFILING
     m_FBC_stats.bytes = 0L;
-#endif
+}
+
+void
+FabArrayBase::pruneFBCache ()
+{
+    if (fb_cache_max_bytes < 0) { return; }
+
+    Vector<const CommMetaData*> lru;
+    for (auto const& kv : m_TheFBCache) {
+        if (kv.second->m_npinned == 0) {
+            lru.push_back(kv.second);
+        }
+    }
+    const int nevict = numCommCacheEvictions(lru, m_FBC_stats.bytes, fb_cache_max_bytes);
+
+    for (int i = 0; i < nevict; ++i)
+    {
+        auto* fb = static_cast<FB*>(const_cast<CommMetaData*>(lru[i]));
+        for (auto it = m_TheFBCache.begin(); it != m_TheFBCache.end(); ++it) {
+            if (it->second == fb) {
+                m_TheFBCache.erase(it);
+                break;
+            }
+        }
+
+        m_FBC_stats.bytes -= fb->m_bytes;
+        m_FBC_stats.recordEvict(fb->m_nuse);
+        delete fb;
+    }
 }
 
 const FabArrayBase::FB&
@@ -1215,6 +1633,7 @@ FabArrayBase::getFB (const IntVect& nghost, const Periodicity& period,
             it->second->m_period     == period              )
         {
             ++(it->second->m_nuse);
+            it->second->m_last_use = ++m_comm_cache_tick;
             m_FBC_stats.recordUse();
             return *(it->second);
         }
@@ -1224,20 +1643,372 @@ FabArrayBase::getFB (const IntVect& nghost, const Periodicity& period,
     FB* new_fb = new FB(*this, nghost, cross, period, enforce_periodicity_only,
                         override_sync, m_multi_ghost);
 
-#ifdef AMREX_MEM_PROFILING
-    m_FBC_stats.bytes += new_fb->bytes();
+    new_fb->m_bytes = new_fb->bytes();
+    m_FBC_stats.bytes += new_fb->m_bytes;
     m_FBC_stats.bytes_hwm = std::max(m_FBC_stats.bytes_hwm, m_FBC_stats.bytes);
-#endif
 
     new_fb->m_nuse = 1;
+    new_fb->m_last_use = ++m_comm_cache_tick;
     m_FBC_stats.recordBuild();
     m_FBC_stats.recordUse();
 
-    m_TheFBCache.insert(er_it.second, FBCache::value_type(m_bdkey,new_fb));
+    // The new one is not in the cache yet and therefore will not be evicted.
+    pruneFBCache();
+
+    m_TheFBCache.insert(FBCache::value_type(m_bdkey,new_fb));
 
     return *new_fb;
 }
 
+const FabArrayBase::NodeInfo&
+FabArrayBase::getNodeInfo ()
+{
+    MPI_Comm comm = ParallelContext::CommunicatorSub();
+    auto it = node_info_cache.find(comm);
+    if (it != node_info_cache.end()) {
+        return it->second;
+    }
+
+    NodeInfo& node = node_info_cache[comm];
+    const int myproc = ParallelDescriptor::MyProc();
+    node.node_rank.resize(ParallelDescriptor::NProcs(), -1);
+#ifdef BL_USE_MPI
+    if (ParallelContext::NProcsSub() > 1)
+    {
+        const int myproc_sub = ParallelContext::MyProcSub();
+        MPI_Comm node_comm;
+        BL_MPI_REQUIRE( MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, myproc_sub,
+                                            MPI_INFO_NULL, &node_comm) );
+        int node_size, node_rank;
+        MPI_Comm_size(node_comm, &node_size);
+        MPI_Comm_rank(node_comm, &node_rank);
+        if (node_shared_group_size > 0 && node_size > node_shared_group_size) {
+            // Split the node into groups of consecutive ranks.
+            BL_MPI_REQUIRE( MPI_Comm_split(node_comm, node_rank/node_shared_group_size,
+                                           node_rank, &node.comm) );
+            MPI_Comm_free(&node_comm);
+        } else {
+            node.comm = node_comm;
+        }
+        MPI_Comm_size(node.comm, &node.size);
+        Vector<int> global_rank(node.size);
+        BL_MPI_REQUIRE( MPI_Allgather(&myproc, 1, MPI_INT, global_rank.data(), 1, MPI_INT,
+                                      node.comm) );
+        for (int i = 0; i < node.size; ++i) {
+            node.node_rank[global_rank[i]] = i;
+        }
+    }
+    else
+#endif
+    {
+        node.node_rank[myproc] = 0;
+    }
+    return node;
+}
+
+Long
+FabArrayBase::NodeSplit::bytes () const
+{
+    Long cnt = static_cast<Long>(sizeof(NodeSplit));
+    if (m_SndTags) {
+        cnt += FabArrayBase::bytesOfMapOfCopyComTagContainers(*m_SndTags);
+    }
+    if (m_RcvTags) {
+        cnt += FabArrayBase::bytesOfMapOfCopyComTagContainers(*m_RcvTags);
+    }
+    if (m_ShmTags) {
+        cnt += amrex::bytesOf(*m_ShmTags);
+    }
+    return cnt;
+}
+
+const FabArrayBase::NodeSplit&
+FabArrayBase::FB::getNodeSplit (const NodeInfo& node) const
+{
+    if (m_node_split && m_node_split->m_node == &node) {
+        return *m_node_split;
+    }
+
+    BL_PROFILE("FabArrayBase::FB::getNodeSplit()");
+
+    auto split = std::make_unique<NodeSplit>();
+    split->m_node = &node;
+    split->m_SndTags = std::make_unique<MapOfCopyComTagContainers>();
+    split->m_RcvTags = std::make_unique<MapOfCopyComTagContainers>();
+    split->m_ShmTags = std::make_unique<CopyComTagsContainer>();
+
+    // Nothing is sent to the processes on this node, because they read
+    // straight from our fabs.
+    for (auto const& kv : *m_SndTags) {
+        if (node.node_rank[kv.first] < 0) {
+            split->m_SndTags->emplace(kv);
+        }
+    }
+    for (auto const& kv : *m_RcvTags) {
+        if (node.node_rank[kv.first] < 0) {
+            split->m_RcvTags->emplace(kv);
+        } else {
+            split->m_ShmTags->insert(split->m_ShmTags->end(), kv.second.begin(), kv.second.end());
+        }
+    }
+
+    Long nbytes = split->bytes();
+    if (m_node_split) {
+        nbytes -= m_node_split->bytes();
+        // Persistent requests built for the old split are no longer valid.
+        for (auto& pc : m_persistent) {
+            if (pc && (pc->m_snd_tags == m_node_split->m_SndTags.get() ||
+                       pc->m_rcv_tags == m_node_split->m_RcvTags.get())) {
+                nbytes -= pc->bytes();
+                pc.reset();
+            }
+        }
+        m_persistent.erase(std::remove(m_persistent.begin(), m_persistent.end(), nullptr),
+                           m_persistent.end());
+    }
+    m_bytes += nbytes;
+    m_FBC_stats.bytes += nbytes;
+    m_FBC_stats.bytes_hwm = std::max(m_FBC_stats.bytes_hwm, m_FBC_stats.bytes);
+
+    m_node_split = std::move(split);
+    return *m_node_split;
+}
+
+MPI_Comm
+FabArrayBase::getPersistentCommunicator ()
+{
+    MPI_Comm comm = ParallelContext::CommunicatorSub();
+    auto it = persistent_comm_cache.find(comm);
+    if (it != persistent_comm_cache.end()) {
+        return it->second;
+    }
+    MPI_Comm dup = MPI_COMM_NULL;
+#ifdef BL_USE_MPI
+    BL_MPI_REQUIRE( MPI_Comm_dup(comm, &dup) );
+#endif
+    persistent_comm_cache[comm] = dup;
+    return dup;
+}
+
+#ifdef BL_USE_MPI
+namespace {
+    // Same choice of data type as ParallelDescriptor::Asend and Arecv
+    void comm_init_request (bool send, char* buf, std::size_t nbytes, int rank,
+                            MPI_Comm comm, MPI_Request* req)
+    {
+        MPI_Datatype datatype;
+        std::size_t count;
+        const int comm_data_type = ParallelDescriptor::select_comm_data_type(nbytes);
+        if (comm_data_type == 1) {
+            datatype = ParallelDescriptor::Mpi_typemap<char>::type();
+            count = nbytes;
+        } else if (comm_data_type == 2) {
+            datatype = ParallelDescriptor::Mpi_typemap<unsigned long long>::type();
+            count = nbytes / sizeof(unsigned long long);
+        } else if (comm_data_type == 3) {
+            datatype = ParallelDescriptor::Mpi_typemap<ParallelDescriptor::lull_t>::type();
+            count = nbytes / sizeof(ParallelDescriptor::lull_t);
+        } else {
+            amrex::Abort("TODO: message size is too big");
+            return;
+        }
+        // All persistent messages use tag 0 on their own communicator.
+        // They are matched in the order they are started.
+        if (send) {
+            BL_MPI_REQUIRE( MPI_Send_init(buf, static_cast<int>(count), datatype, rank, 0,
+                                          comm, req) );
+        } else {
+            BL_MPI_REQUIRE( MPI_Recv_init(buf, static_cast<int>(count), datatype, rank, 0,
+                                          comm, req) );
+        }
+    }
+
+    void start_requests (Vector<MPI_Request>& reqs)
+    {
+        for (auto& req : reqs) {
+            if (req != MPI_REQUEST_NULL) {
+                BL_MPI_REQUIRE( MPI_Start(&req) );
+            }
+        }
+    }
+
+    void free_requests (Vector<MPI_Request>& reqs)
+    {
+        for (auto& req : reqs) {
+            if (req != MPI_REQUEST_NULL) {
+                MPI_Request_free(&req);
+            }
+        }
+    }
+}
+#endif
+
+FabArrayBase::PersistentComm::~PersistentComm ()
+{
+#ifdef BL_USE_MPI
+    AMREX_ASSERT(!m_in_use);
+    free_requests(send_reqs);
+    free_requests(recv_reqs);
+#endif
+    The_Comms_Arena()->free(the_send_data);
+    The_Comms_Arena()->free(the_recv_data);
+}
+
+void
+FabArrayBase::PersistentComm::init_requests ()
+{
+#ifdef BL_USE_MPI
+    send_reqs.assign(send_size.size(), MPI_REQUEST_NULL);
+    for (int i = 0, N = static_cast<int>(send_size.size()); i < N; ++i) {
+        if (send_size[i] > 0) {
+            const int rank = ParallelContext::global_to_local_rank(send_rank[i]);
+            comm_init_request(true, send_data[i], send_size[i], rank, m_comm, &send_reqs[i]);
+        }
+    }
+    recv_reqs.assign(recv_size.size(), MPI_REQUEST_NULL);
+    for (int i = 0, N = static_cast<int>(recv_size.size()); i < N; ++i) {
+        if (recv_size[i] > 0) {
+            const int rank = ParallelContext::global_to_local_rank(recv_from[i]);
+            comm_init_request(false, recv_data[i], recv_size[i], rank, m_comm, &recv_reqs[i]);
+        }
+    }
+#endif
+}
+
+void
+FabArrayBase::PersistentComm::start_recvs ()
+{
+#ifdef BL_USE_MPI
+    start_requests(recv_reqs);
+#endif
+}
+
+void
+FabArrayBase::PersistentComm::start_sends ()
+{
+#ifdef BL_USE_MPI
+    start_requests(send_reqs);
+#endif
+}
+
+Long
+FabArrayBase::PersistentComm::bytes () const
+{
+    Long cnt = sizeof(PersistentComm);
+    for (auto sz : send_size) { cnt += static_cast<Long>(sz); }
+    for (auto sz : recv_size) { cnt += static_cast<Long>(sz); }
+    cnt += static_cast<Long>((send_data.size() + recv_data.size()) * sizeof(char*)
+                             + (send_size.size() + recv_size.size()) * sizeof(std::size_t)
+                             + (send_rank.size() + recv_from.size()) * sizeof(int)
+                             + (send_reqs.size() + recv_reqs.size()) * sizeof(MPI_Request)
+                             + send_cctc.size() * sizeof(CopyComTagsContainer*));
+    return cnt;
+}
+
+FabArrayBase::NeighborComm::~NeighborComm ()
+{
+#ifdef BL_USE_MPI
+    if (m_comm != MPI_COMM_NULL) {
+        MPI_Comm_free(&m_comm);
+    }
+#endif
+}
+
+Long
+FabArrayBase::NeighborComm::bytes () const
+{
+    return static_cast<Long>(sizeof(NeighborComm)
+                             + (m_srcs.size() + m_dsts.size()) * sizeof(int));
+}
+
+const FabArrayBase::NeighborComm&
+FabArrayBase::getNeighborComm (const CommMetaData& cmd, CacheStats& stats)
+{
+    MPI_Comm comm = ParallelContext::CommunicatorSub();
+    for (auto const& nc : cmd.m_neighbors) {
+        if (nc->m_comm_sub == comm) { return *nc; }
+    }
+
+    BL_PROFILE("FabArrayBase::getNeighborComm()");
+
+    auto nc = std::make_unique<NeighborComm>();
+    nc->m_comm_sub = comm;
+    for (auto const& kv : *cmd.m_RcvTags) {
+        nc->m_srcs.push_back(kv.first);
+    }
+    for (auto const& kv : *cmd.m_SndTags) {
+        nc->m_dsts.push_back(kv.first);
+    }
+#ifdef BL_USE_MPI
+    Vector<int> srcs(nc->m_srcs.size());
+    Vector<int> dsts(nc->m_dsts.size());
+    for (int i = 0, N = static_cast<int>(srcs.size()); i < N; ++i) {
+        srcs[i] = ParallelContext::global_to_local_rank(nc->m_srcs[i]);
+    }
+    for (int i = 0, N = static_cast<int>(dsts.size()); i < N; ++i) {
+        dsts[i] = ParallelContext::global_to_local_rank(nc->m_dsts[i]);
+    }
+    BL_MPI_REQUIRE( MPI_Dist_graph_create_adjacent(comm,
+                                                   static_cast<int>(srcs.size()), srcs.data(),
+                                                   MPI_UNWEIGHTED,
+                                                   static_cast<int>(dsts.size()), dsts.data(),
+                                                   MPI_UNWEIGHTED,
+                                                   MPI_INFO_NULL, 0, &nc->m_comm) );
+#endif
+
+    const Long nbytes = nc->bytes();
+    cmd.m_bytes += nbytes;
+    stats.bytes += nbytes;
+    stats.bytes_hwm = std::max(stats.bytes_hwm, stats.bytes);
+
+    cmd.m_neighbors.push_back(std::move(nc));
+    return *cmd.m_neighbors.back();
+}
+
+#ifdef BL_USE_MPI
+namespace {
+    void neighbor_counts (Vector<int> const& neighbors, char* base,
+                          Vector<char*> const& data, Vector<std::size_t> const& size,
+                          Vector<int> const& rank, Vector<int>& counts, Vector<int>& displs)
+    {
+        counts.assign(neighbors.size(), 0);
+        displs.assign(neighbors.size(), 0);
+        // Both neighbors and rank are sorted.
+        int j = 0;
+        for (int i = 0, N = static_cast<int>(neighbors.size()); i < N; ++i) {
+            if (j < static_cast<int>(rank.size()) && rank[j] == neighbors[i]) {
+                const std::size_t displ = data[j] - base;
+                if (size[j] + displ > std::size_t(std::numeric_limits<int>::max())) {
+                    amrex::Abort("fabarray.neighbor_collective: message size is too big");
+                }
+                counts[i] = static_cast<int>(size[j]);
+                displs[i] = static_cast<int>(displ);
+                ++j;
+            }
+        }
+        AMREX_ASSERT(j == static_cast<int>(rank.size()));
+    }
+}
+
+void
+FabArrayBase::PostNeighbor (const NeighborComm& nc, char* the_send_data,
+                            Vector<char*> const& send_data,
+                            Vector<std::size_t> const& send_size,
+                            Vector<int> const& send_rank, char* the_recv_data,
+                            Vector<char*> const& recv_data,
+                            Vector<std::size_t> const& recv_size,
+                            Vector<int> const& recv_from, MPI_Request& req)
+{
+    Vector<int> scounts, sdispls, rcounts, rdispls;
+    neighbor_counts(nc.m_dsts, the_send_data, send_data, send_size, send_rank, scounts, sdispls);
+    neighbor_counts(nc.m_srcs, the_recv_data, recv_data, recv_size, recv_from, rcounts, rdispls);
+    const MPI_Datatype datatype = ParallelDescriptor::Mpi_typemap<char>::type();
+    BL_MPI_REQUIRE( MPI_Ineighbor_alltoallv(the_send_data, scounts.data(), sdispls.data(),
+                                            datatype, the_recv_data, rcounts.data(),
+                                            rdispls.data(), datatype, nc.m_comm, &req) );
+}
+#endif
+
 FabArrayBase::RB90::RB90 (const FabArrayBase& fa, const IntVect& nghost, Box const& domain)
     : m_ngrow(nghost), m_domain(domain)
 {
@@ -2225,6 +2996,24 @@ FabArrayBase::Finalize ()
     m_CFinfo_stats = CacheStats("CrseFineCache");
 
     m_BD_count.clear();
+    m_comm_cache_tick = 0;
+
+#ifdef BL_USE_MPI
+    for (auto& kv : node_info_cache) {
+        if (kv.second.comm != MPI_COMM_NULL) {
+            MPI_Comm_free(&kv.second.comm);
+        }
+    }
+#endif
+    node_info_cache.clear();
+
+#ifdef BL_USE_MPI
+    for (auto& kv : persistent_comm_cache) {
+        MPI_Comm_free(&kv.second);
+    }
+#endif
+    persistent_comm_cache.clear();
+    comm_cache_file = CommCacheFile();
 
     m_FA_stats = FabArrayStats();
 
@@ -0,0 +1,483 @@
+#include <AMReX_InSituReduce.H>
+#include <AMReX_MultiFabUtil.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_PlotFileUtil.H>
+#include <AMReX_Utility.H>
+#include <AMReX.H>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <utility>
+
+namespace amrex {
+
+int
+InSituData::comp (std::string const& var) const
+{
+    auto it = std::find(varnames.begin(), varnames.end(), var);
+    return (it == varnames.end()) ? -1 : static_cast<int>(it - varnames.begin());
+}
+
+InSituReducer::InSituReducer (std::string name, std::string const& default_file)
+    : m_name(std::move(name)),
+      m_file(default_file)
+{
+    ParmParse pp("reduce." + m_name);
+    pp.getarr("vars", m_vars);
+    pp.queryAdd("int", m_int);
+    pp.queryAdd("file", m_file);
+}
+
+int
+InSituReducer::comp (InSituData const& data, std::string const& var) const
+{
+    int c = data.comp(var);
+    if (c < 0) {
+        amrex::Abort("InSituReducer " + m_name + ": variable " + var + " not found");
+    }
+    return c;
+}
+
+namespace {
+
+// 1 where lev is covered by lev+1, 0 elsewhere
+iMultiFab covered_mask (InSituData const& data, int lev)
+{
+    MultiFab const& mf = *data.mf[lev];
+    if (lev < data.nlevels-1) {
+        return makeFineMask(mf.boxArray(), mf.DistributionMap(),
+                            data.mf[lev+1]->boxArray(), data.ref_ratio[lev]);
+    } else {
+        iMultiFab mask(mf.boxArray(), mf.DistributionMap(), 1, 0);
+        mask.setVal(0);
+        return mask;
+    }
+}
+
+Real cell_volume (Geometry const& geom)
+{
+    Real dv = 1.0;
+    for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+        dv *= geom.CellSize(idim);
+    }
+    return dv;
+}
+
+// Open a text file for appending one record.  The header is written if the file is new.
+std::ofstream open_series (std::string const& file, std::string const& header)
+{
+    bool const is_new = ! amrex::FileExists(file);
+    std::ofstream ofs(file, std::ios::out | std::ios::app);
+    if ( ! ofs.good()) {
+        amrex::FileOpenFailed(file);
+    }
+    ofs.precision(std::numeric_limits<Real>::max_digits10);
+    if (is_new) {
+        ofs << header << '\n';
+    }
+    return ofs;
+}
+
+std::string var_list (Vector<std::string> const& vars, std::string const& suffix = std::string())
+{
+    std::string s;
+    for (auto const& v : vars) {
+        s += "  " + v + suffix;
+    }
+    return s;
+}
+
+class HorizontalAverage final
+    : public InSituReducer
+{
+public:
+    explicit HorizontalAverage (std::string const& name)
+        : InSituReducer(name, name + ".dat")
+    {
+        ParmParse pp("reduce." + name);
+        pp.queryAdd("dir", m_dir);
+    }
+
+    void reduce (InSituData const& data) override
+    {
+        const int nv = static_cast<int>(m_vars.size());
+        const int flev = data.nlevels-1;
+        const int nbins = data.geom[flev].Domain().length(m_dir);
+        Vector<Real> sum(nv*nbins, 0.0);
+        Vector<Real> vol(nbins, 0.0);
+
+        int ratio = 1;  // ---- from lev to flev in m_dir
+        for (int lev = flev; lev >= 0; --lev) {
+            if (lev < flev) {
+                ratio *= data.ref_ratio[lev][m_dir];
+            }
+            MultiFab const& mf = *data.mf[lev];
+            iMultiFab mask = covered_mask(data, lev);
+            MultiFab tmp(mf.boxArray(), mf.DistributionMap(), nv+1, 0);
+            auto const& ma = mask.const_arrays();
+            auto const& sa = mf.const_arrays();
+            auto const& ta = tmp.arrays();
+            ParallelFor(tmp, [=] AMREX_GPU_DEVICE (int b, int i, int j, int k) noexcept
+            {
+                ta[b](i,j,k,nv) = ma[b](i,j,k) ? 0.0_rt : 1.0_rt;
+            });
+            for (int n = 0; n < nv; ++n) {
+                const int c = comp(data, m_vars[n]);
+                ParallelFor(tmp, [=] AMREX_GPU_DEVICE (int b, int i, int j, int k) noexcept
+                {
+                    ta[b](i,j,k,n) = ma[b](i,j,k) ? 0.0_rt : sa[b](i,j,k,c);
+                });
+            }
+            Gpu::streamSynchronize();
+
+            auto line = sumToLine(tmp, 0, nv+1, data.geom[lev].Domain(), m_dir);
+            const Real dv = cell_volume(data.geom[lev]) / static_cast<Real>(ratio);
+            const int ncells = data.geom[lev].Domain().length(m_dir);
+            for (int ic = 0; ic < ncells; ++ic) {
+                for (int q = 0; q < ratio; ++q) {
+                    const int ib = ic*ratio + q;
+                    vol[ib] += line[nv + (nv+1)*ic] * dv;
+                    for (int n = 0; n < nv; ++n) {
+                        sum[n*nbins + ib] += line[n + (nv+1)*ic] * dv;
+                    }
+                }
+            }
+        }
+
+        if (ParallelDescriptor::IOProcessor()) {
+            auto ofs = open_series(m_file, "# horizontal averages, one block per step\n"
+                                   "# " + std::string(1, "xyz"[m_dir]) + var_list(m_vars));
+            ofs << "# step " << data.step << " time " << data.time << '\n';
+            const Real lo = data.geom[flev].ProbLo(m_dir);
+            const Real dx = data.geom[flev].CellSize(m_dir);
+            for (int ib = 0; ib < nbins; ++ib) {
+                ofs << lo + (ib + 0.5_rt)*dx;
+                for (int n = 0; n < nv; ++n) {
+                    ofs << ' ' << ((vol[ib] > 0.0) ? sum[n*nbins + ib]/vol[ib] : 0.0);
+                }
+                ofs << '\n';
+            }
+            ofs << '\n';
+        }
+    }
+
+private:
+    int m_dir = AMREX_SPACEDIM-1;
+};
+
+class VolumeSum final
+    : public InSituReducer
+{
+public:
+    explicit VolumeSum (std::string const& name)
+        : InSituReducer(name, name + ".dat")
+    {}
+
+    void reduce (InSituData const& data) override
+    {
+        Vector<Real> sums;
+        for (auto const& v : m_vars) {
+            sums.push_back(volumeWeightedSum(data.mf, comp(data, v), data.geom,
+                                             data.ref_ratio, true));
+        }
+        const int IOProc = ParallelDescriptor::IOProcessorNumber();
+        ParallelDescriptor::ReduceRealSum(sums.data(), static_cast<int>(sums.size()), IOProc);
+
+        if (ParallelDescriptor::IOProcessor()) {
+            auto ofs = open_series(m_file, "# step  time" + var_list(m_vars));
+            ofs << data.step << ' ' << data.time;
+            for (auto s : sums) {
+                ofs << ' ' << s;
+            }
+            ofs << '\n';
+        }
+    }
+};
+
+class Extrema final
+    : public InSituReducer
+{
+public:
+    explicit Extrema (std::string const& name)
+        : InSituReducer(name, name + ".dat")
+    {}
+
+    void reduce (InSituData const& data) override
+    {
+        const int nv = static_cast<int>(m_vars.size());
+        Vector<Real> vmin(nv, std::numeric_limits<Real>::max());
+        Vector<Real> vmax(nv, std::numeric_limits<Real>::lowest());
+        for (int lev = 0; lev < data.nlevels; ++lev) {
+            for (int n = 0; n < nv; ++n) {
+                const int c = comp(data, m_vars[n]);
+                vmin[n] = std::min(vmin[n], data.mf[lev]->min(c, 0, true));
+                vmax[n] = std::max(vmax[n], data.mf[lev]->max(c, 0, true));
+            }
+        }
+        const int IOProc = ParallelDescriptor::IOProcessorNumber();
+        ParallelDescriptor::ReduceRealMin(vmin.data(), nv, IOProc);
+        ParallelDescriptor::ReduceRealMax(vmax.data(), nv, IOProc);
+
+        if (ParallelDescriptor::IOProcessor()) {
+            std::string header("# step  time");
+            for (auto const& v : m_vars) {
+                header += "  min(" + v + ")  max(" + v + ")";
+            }
+            auto ofs = open_series(m_file, header);
+            ofs << data.step << ' ' << data.time;
+            for (int n = 0; n < nv; ++n) {
+                ofs << ' ' << vmin[n] << ' ' << vmax[n];
+            }
+            ofs << '\n';
+        }
+    }
+};
+
+class Histogram final
+    : public InSituReducer
+{
+public:
+    explicit Histogram (std::string const& name)
+        : InSituReducer(name, name + ".dat")
+    {
+        ParmParse pp("reduce." + name);
+        pp.queryAdd("nbins", m_nbins);
+        pp.queryarr("range", m_range);
+        AMREX_ALWAYS_ASSERT(m_nbins > 0 && (m_range.empty() || m_range.size() == 2));
+    }
+
+    void reduce (InSituData const& data) override
+    {
+        Vector<Real> lo(m_vars.size()), hi(m_vars.size());
+        Vector<Real> hist(m_vars.size()*m_nbins, 0.0);
+        for (int n = 0; n < static_cast<int>(m_vars.size()); ++n) {
+            const int c = comp(data, m_vars[n]);
+            if (m_range.empty()) {
+                lo[n] = std::numeric_limits<Real>::max();
+                hi[n] = std::numeric_limits<Real>::lowest();
+                for (int lev = 0; lev < data.nlevels; ++lev) {
+                    lo[n] = std::min(lo[n], data.mf[lev]->min(c));
+                    hi[n] = std::max(hi[n], data.mf[lev]->max(c));
+                }
+            } else {
+                lo[n] = m_range[0];
+                hi[n] = m_range[1];
+            }
+            const Real vlo = lo[n];
+            const Real vhi = hi[n];
+            const Real dxinv = (vhi > vlo) ? m_nbins / (vhi - vlo) : 0.0_rt;
+            const int nbins = m_nbins;
+
+            Gpu::DeviceVector<Real> dhist(m_nbins, 0.0);
+            Real* p = dhist.data();
+            for (int lev = 0; lev < data.nlevels; ++lev) {
+                iMultiFab mask = covered_mask(data, lev);
+                auto const& ma = mask.const_arrays();
+                auto const& sa = data.mf[lev]->const_arrays();
+                const Real dv = cell_volume(data.geom[lev]);
+                ParallelFor(*data.mf[lev], [=] AMREX_GPU_DEVICE (int b, int i, int j, int k) noexcept
+                {
+                    const Real v = sa[b](i,j,k,c);
+                    if (ma[b](i,j,k) == 0 && v >= vlo && v <= vhi) {
+                        const int ib = amrex::min(static_cast<int>((v - vlo)*dxinv), nbins-1);
+                        HostDevice::Atomic::Add(p+ib, dv);
+                    }
+                });
+            }
+            Gpu::copy(Gpu::deviceToHost, dhist.begin(), dhist.end(), hist.begin() + n*m_nbins);
+        }
+        const int IOProc = ParallelDescriptor::IOProcessorNumber();
+        ParallelDescriptor::ReduceRealSum(hist.data(), static_cast<int>(hist.size()), IOProc);
+
+        if (ParallelDescriptor::IOProcessor()) {
+            auto ofs = open_series(m_file, "# step  time  variable  lo  hi  volume fraction in each of "
+                                   + std::to_string(m_nbins) + " bins");
+            const Real volinv = 1.0_rt / data.geom[0].ProbDomain().volume();
+            for (int n = 0; n < static_cast<int>(m_vars.size()); ++n) {
+                ofs << data.step << ' ' << data.time << ' ' << m_vars[n] << ' ' << lo[n] << ' ' << hi[n];
+                for (int ib = 0; ib < m_nbins; ++ib) {
+                    ofs << ' ' << hist[n*m_nbins + ib] * volinv;
+                }
+                ofs << '\n';
+            }
+        }
+    }
+
+private:
+    int m_nbins = 64;
+    Vector<Real> m_range;
+};
+
+class Slice final
+    : public InSituReducer
+{
+public:
+    explicit Slice (std::string const& name)
+        : InSituReducer(name, name + "_")
+    {
+        ParmParse pp("reduce." + name);
+        pp.queryAdd("dir", m_dir);
+        pp.queryAdd("level", m_level);
+        m_has_coord = pp.query("coord", m_coord);
+    }
+
+    void reduce (InSituData const& data) override
+    {
+        const int lev = std::min(m_level, data.nlevels-1);
+        Geometry const& geom = data.geom[lev];
+        const Real coord = m_has_coord ? m_coord
+            : 0.5_rt*(geom.ProbLo(m_dir) + geom.ProbHi(m_dir));
+        MultiFab const& mf = *data.mf[lev];
+
+        auto slice = get_slice_data(m_dir, coord, mf, geom, 0, mf.nComp());
+        MultiFab out(slice->boxArray(), slice->DistributionMap(),
+                     static_cast<int>(m_vars.size()), 0);
+        for (int n = 0; n < static_cast<int>(m_vars.size()); ++n) {
+            MultiFab::Copy(out, *slice, comp(data, m_vars[n]), n, 1, 0);
+        }
+        WriteSingleLevelPlotfile(amrex::Concatenate(m_file, data.step, 5), out, m_vars,
+                                 geom, data.time, data.step);
+    }
+
+private:
+    int m_dir = AMREX_SPACEDIM-1;
+    int m_level = 0;
+    bool m_has_coord = false;
+    Real m_coord = 0.0;
+};
+
+template <class T>
+InSituReduce::Factory make_factory ()
+{
+    return [] (std::string const& name) -> std::unique_ptr<InSituReducer>
+    {
+        return std::make_unique<T>(name);
+    };
+}
+
+bool s_initialized = false;
+std::map<std::string, InSituReduce::Factory> s_types;
+Vector<std::unique_ptr<InSituReducer>> s_reducers;
+
+void init_reducers ()
+{
+    if (s_initialized) { return; }
+    s_initialized = true;
+
+    // ---- emplace does not replace types registered by the user
+    s_types.emplace("horizontal_average", make_factory<HorizontalAverage>());
+    s_types.emplace("volume_sum", make_factory<VolumeSum>());
+    s_types.emplace("extrema", make_factory<Extrema>());
+    s_types.emplace("histogram", make_factory<Histogram>());
+    s_types.emplace("slice", make_factory<Slice>());
+
+    ParmParse pp("reduce");
+    Vector<std::string> names;
+    pp.queryarr("reducers", names);
+    for (auto const& name : names) {
+        ParmParse ppr("reduce." + name);
+        std::string type;
+        ppr.get("type", type);
+        auto it = s_types.find(type);
+        if (it == s_types.end()) {
+            amrex::Abort("InSituReduce: unknown type " + type + " for reducer " + name);
+        }
+        s_reducers.push_back(it->second(name));
+    }
+
+    amrex::ExecOnFinalize(InSituReduce::Finalize);
+}
+
+}
+
+namespace InSituReduce {
+
+void
+RegisterType (std::string const& type, Factory const& factory)
+{
+    s_types[type] = factory;
+}
+
+Vector<InSituReducer*>
+PlotfileReducers ()
+{
+    init_reducers();
+    Vector<InSituReducer*> r;
+    for (auto const& p : s_reducers) {
+        if (p->interval() <= 0) {
+            r.push_back(p.get());
+        }
+    }
+    return r;
+}
+
+Vector<InSituReducer*>
+ScheduledReducers (int step)
+{
+    init_reducers();
+    Vector<InSituReducer*> r;
+    for (auto const& p : s_reducers) {
+        if (p->interval() > 0 && step % p->interval() == 0) {
+            r.push_back(p.get());
+        }
+    }
+    return r;
+}
+
+Vector<std::string>
+Variables (Vector<InSituReducer*> const& reducers)
+{
+    Vector<std::string> vars;
+    for (auto const* p : reducers) {
+        for (auto const& v : p->variables()) {
+            if (std::find(vars.begin(), vars.end(), v) == vars.end()) {
+                vars.push_back(v);
+            }
+        }
+    }
+    return vars;
+}
+
+void
+Reduce (Vector<InSituReducer*> const& reducers, InSituData const& data)
+{
+    BL_PROFILE("InSituReduce::Reduce()");
+    for (auto* p : reducers) {
+        p->reduce(data);
+    }
+}
+
+void
+Reduce (int nlevels, Vector<MultiFab const*> const& mf,
+        Vector<std::string> const& varnames, Vector<Geometry> const& geom,
+        Real time, int step, Vector<IntVect> const& ref_ratio)
+{
+    auto reducers = PlotfileReducers();
+    if (reducers.empty()) { return; }
+
+    InSituData data;
+    data.nlevels = nlevels;
+    data.mf = mf;
+    data.varnames = varnames;
+    data.geom = geom;
+    data.ref_ratio = ref_ratio;
+    data.time = time;
+    data.step = step;
+    Reduce(reducers, data);
+}
+
+void
+Finalize ()
+{
+    s_reducers.clear();
+    s_types.clear();
+    s_initialized = false;
+}
+
+}
+
+}
@@ -0,0 +1,84 @@
+#include <AMReX_MappedFile.H>
+#include <AMReX.H>
+#include <AMReX_Utility.H>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace amrex {
+
+MappedFile::MappedFile (std::string name)
+    : m_name(std::move(name))
+{
+#ifdef _WIN32
+    std::ifstream ifs(m_name, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!ifs.good()) {
+        amrex::FileOpenFailed(m_name);
+    }
+    m_size = static_cast<Long>(ifs.tellg());
+    m_buffer.resize(m_size);
+    ifs.seekg(0, std::ios::beg);
+    ifs.read(m_buffer.data(), static_cast<std::streamsize>(m_size));
+    m_data = m_buffer.data();
+#else
+    int fd = ::open(m_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        amrex::FileOpenFailed(m_name);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        amrex::Abort("MappedFile: fstat failed for " + m_name + ": " + std::strerror(errno));
+    }
+    m_size = static_cast<Long>(st.st_size);
+    if (m_size > 0) {
+        void* p = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd);
+            amrex::Abort("MappedFile: mmap failed for " + m_name + ": " + std::strerror(errno));
+        }
+        ::madvise(p, m_size, MADV_RANDOM);
+        m_data = static_cast<char*>(p);
+    }
+    // The mapping stays valid after the file is closed.
+    ::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile ()
+{
+#ifndef _WIN32
+    if (m_data != nullptr) {
+        ::munmap(m_data, m_size);
+    }
+#endif
+}
+
+void
+MappedFile::willNeed (Long offset, Long nbytes) const
+{
+#ifdef _WIN32
+    amrex::ignore_unused(offset, nbytes);
+#else
+    if (m_data == nullptr || nbytes <= 0) { return; }
+    static const Long pagesize = ::sysconf(_SC_PAGESIZE);
+    Long begin = (offset / pagesize) * pagesize;
+    Long end = std::min(offset + nbytes, m_size);
+    if (end > begin) {
+        ::madvise(m_data + begin, end - begin, MADV_WILLNEED);
+    }
+#endif
+}
+
+}
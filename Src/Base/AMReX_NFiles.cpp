@@ -4,8 +4,247 @@
 #include <set>
 #include <utility>
 
+#if defined(__unix__) || defined(__APPLE__)
+#define AMREX_NFILES_PWRITE
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace amrex {
 
+#ifdef AMREX_NFILES_PWRITE
+
+/**
+* \brief Writes a stream of bytes to the end of a file with a pool of threads.
+* The bytes are copied into chunks that end at aligned file offsets, so all
+* but the partial blocks at the ends of a chunk can be written with O_DIRECT.
+* The partial blocks go through the page cache.  Without O_DIRECT, or if the
+* file system rejects a direct write, the whole chunk goes through the page cache.
+*/
+class NFilesDirectWriter
+{
+  public:
+
+    NFilesDirectWriter(std::string filename, bool append, int nthreads);
+    ~NFilesDirectWriter();
+
+    NFilesDirectWriter (NFilesDirectWriter const&) = delete;
+    NFilesDirectWriter (NFilesDirectWriter &&) = delete;
+    NFilesDirectWriter& operator= (NFilesDirectWriter const&) = delete;
+    NFilesDirectWriter& operator= (NFilesDirectWriter &&) = delete;
+
+    void Write(const char *data, Long nbytes);
+
+    //! the file offset of the next byte
+    [[nodiscard]] Long Position() const { return filePos; }
+
+    //! wait for the writes to finish and close the file
+    void Close();
+
+  private:
+
+    struct Chunk {
+      char *buf = nullptr;  // ---- aligned, buf[offset % alignment] is the first byte
+      Long offset = 0;
+      Long nbytes = 0;
+    };
+
+    static constexpr Long alignment = 4096;
+    static constexpr Long chunkSize = 8 * 1024 * 1024;
+
+    void SubmitChunk();
+    void WriteChunk(const Chunk &c);
+    void WriteAll(int f, const char *data, Long nbytes, Long offset);
+    void Work();
+
+    std::string fileName;
+    int fd = -1, directFd = -1;
+    Long filePos = 0;
+    Chunk current;
+    int maxBuffers = 0, nBuffers = 0;
+    std::vector<char *> freeBuffers;
+    std::deque<Chunk> chunks;
+    std::vector<std::thread> threads;
+    std::mutex chunkMutex;
+    std::condition_variable chunkCond;
+    bool closing = false;
+    int writeError = 0;
+};
+
+
+NFilesDirectWriter::NFilesDirectWriter(std::string filename, bool append, int nthreads)
+    : fileName(std::move(filename)),
+      maxBuffers(2 * nthreads)
+{
+  fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | (append ? 0 : O_TRUNC), 0644);
+  if(fd < 0) {
+    amrex::FileOpenFailed(fileName);
+  }
+  if(append) {
+    filePos = static_cast<Long>(::lseek(fd, 0, SEEK_END));
+  }
+#ifdef O_DIRECT
+  directFd = ::open(fileName.c_str(), O_WRONLY | O_DIRECT);  // ---- -1 if not supported
+#endif
+  for(int i(0); i < nthreads; ++i) {
+    threads.emplace_back([this] () { Work(); });
+  }
+}
+
+
+NFilesDirectWriter::~NFilesDirectWriter() {
+  Close();
+}
+
+
+void NFilesDirectWriter::Write(const char *data, Long nbytes) {
+  while(nbytes > 0) {
+    if(current.buf == nullptr) {
+      std::unique_lock<std::mutex> lck(chunkMutex);
+      chunkCond.wait(lck, [this] () { return ! freeBuffers.empty() || nBuffers < maxBuffers; });
+      if(freeBuffers.empty()) {
+        void *p(nullptr);
+        if(posix_memalign(&p, alignment, chunkSize) != 0) {
+          amrex::Abort("NFilesDirectWriter: out of memory");
+        }
+        freeBuffers.push_back(static_cast<char *>(p));
+        ++nBuffers;
+      }
+      current.buf = freeBuffers.back();
+      freeBuffers.pop_back();
+      current.offset = filePos;
+      current.nbytes = 0;
+    }
+    Long start(current.offset % alignment + current.nbytes);
+    Long n(std::min(nbytes, chunkSize - start));
+    std::memcpy(current.buf + start, data, n);
+    current.nbytes += n;
+    filePos += n;
+    data += n;
+    nbytes -= n;
+    if(start + n == chunkSize) {
+      SubmitChunk();
+    }
+  }
+}
+
+
+void NFilesDirectWriter::SubmitChunk() {
+  {
+    std::lock_guard<std::mutex> lck(chunkMutex);
+    chunks.push_back(current);
+  }
+  chunkCond.notify_all();
+  current = Chunk();
+}
+
+
+void NFilesDirectWriter::Close() {
+  if(fd < 0) {
+    return;
+  }
+  if(current.buf != nullptr) {
+    SubmitChunk();
+  }
+  {
+    std::lock_guard<std::mutex> lck(chunkMutex);
+    closing = true;
+  }
+  chunkCond.notify_all();
+  for(auto &t : threads) {
+    t.join();
+  }
+  threads.clear();
+  for(auto *b : freeBuffers) {
+    std::free(b);
+  }
+  freeBuffers.clear();
+  if(directFd >= 0) {
+    ::close(directFd);
+  }
+  if(::close(fd) != 0 && writeError == 0) {
+    writeError = errno;
+  }
+  fd = directFd = -1;
+  if(writeError != 0) {
+    amrex::Abort("NFilesDirectWriter: writing " + fileName + " failed: "
+                 + std::strerror(writeError));
+  }
+}
+
+
+void NFilesDirectWriter::Work() {
+  std::unique_lock<std::mutex> lck(chunkMutex);
+  while(true) {
+    chunkCond.wait(lck, [this] () { return ! chunks.empty() || closing; });
+    if(chunks.empty()) {
+      return;
+    }
+    Chunk c(chunks.front());
+    chunks.pop_front();
+    lck.unlock();
+    WriteChunk(c);
+    lck.lock();
+    freeBuffers.push_back(c.buf);
+    chunkCond.notify_all();
+  }
+}
+
+
+void NFilesDirectWriter::WriteChunk(const Chunk &c) {
+  const char *data(c.buf + c.offset % alignment);
+  Long end(c.offset + c.nbytes);
+  Long bodyLo(std::min((c.offset + alignment - 1) / alignment * alignment, end));
+  Long bodyHi(std::max(end / alignment * alignment, bodyLo));
+
+  WriteAll(fd, data, bodyLo - c.offset, c.offset);
+  WriteAll(directFd >= 0 ? directFd : fd, data + (bodyLo - c.offset), bodyHi - bodyLo, bodyLo);
+  WriteAll(fd, data + (bodyHi - c.offset), end - bodyHi, bodyHi);
+}
+
+
+void NFilesDirectWriter::WriteAll(int f, const char *data, Long nbytes, Long offset) {
+  while(nbytes > 0) {
+    auto n = ::pwrite(f, data, static_cast<std::size_t>(nbytes), static_cast<off_t>(offset));
+    if(n < 0 && errno == EINTR) {
+      continue;
+    }
+    if(n < 0 && errno == EINVAL && f == directFd) {
+      f = fd;  // ---- the file system does not like this direct write
+      continue;
+    }
+    if(n <= 0) {
+      std::lock_guard<std::mutex> lck(chunkMutex);
+      writeError = (n < 0) ? errno : EIO;
+      return;
+    }
+    data += n;
+    nbytes -= n;
+    offset += n;
+  }
+}
+
+#else
+
+class NFilesDirectWriter
+{
+  public:
+    NFilesDirectWriter(const std::string &, bool, int) {}
+    void Write(const char *, Long) {}
+    [[nodiscard]] Long Position() const { return 0; }
+    void Close() {}
+};
+
+#endif
+
+
 int NFilesIter::currentDeciderIndex(-1);
 int NFilesIter::minDigits(5);
 
@@ -163,14 +402,20 @@ void NFilesIter::SetSparseFPP(const Vector<int> &ranksToWrite)
 
 NFilesIter::NFilesIter(std::string filename,
                        Vector<int> readranks,
-                       bool setBuf)
+                       bool setBuf,
+                       int readTag)
     : myProc       (ParallelDescriptor::MyProc()),
       nProcs       (ParallelDescriptor::NProcs()),
       fullFileName (std::move(filename)),
       isReading    (true),
       readRanks    (std::move(readranks)),
-      myReadIndex  (indexUndefined)
+      myReadIndex  (indexUndefined),
+      stReadTag    (readTag)
 {
+  if(readRanks.size() > 1 && stReadTag < 0) {
+    amrex::Abort("**** Error in NFilesIter:  readTag is required for more than one reader.");
+  }
+
   for(int i(0); i < readRanks.size(); ++i) {
     if(myProc == readRanks[i]) {
       if(myReadIndex != indexUndefined) {
@@ -201,6 +446,48 @@ NFilesIter::~NFilesIter() {
 }
 
 
+void NFilesIter::SetDirectWrite(int nthreads) {
+#ifdef AMREX_NFILES_PWRITE
+  directWriteThreads = std::max(nthreads, 0);
+#else
+  amrex::ignore_unused(nthreads);
+#endif
+}
+
+
+void NFilesIter::OpenWriteFile(bool append) {
+  if(directWriteThreads > 0) {
+    directWriter = std::make_unique<NFilesDirectWriter>(fullFileName, append, directWriteThreads);
+    return;
+  }
+  fileStream.open(fullFileName.c_str(),
+                  std::ios::out | (append ? std::ios::app : std::ios::trunc) | std::ios::binary);
+  if( ! fileStream.good()) {
+    amrex::FileOpenFailed(fullFileName);
+  }
+}
+
+
+void NFilesIter::CloseWriteFile() {
+  if(directWriter) {
+    directWriter->Close();
+    directWriter.reset();
+    return;
+  }
+  fileStream.flush();
+  fileStream.close();
+}
+
+
+void NFilesIter::Write(const char *data, Long nbytes) {
+  if(directWriter) {
+    directWriter->Write(data, nbytes);
+  } else {
+    fileStream.write(data, nbytes);
+  }
+}
+
+
 bool NFilesIter::ReadyToWrite(bool appendFirst) {
 
 #ifdef BL_USE_MPI
@@ -214,16 +501,7 @@ bool NFilesIter::ReadyToWrite(bool appendFirst) {
     if(useSparseFPP) {
 
       if(mySparseFileNumber != -1) {
-        if( ! appendFirst) {
-          fileStream.open(fullFileName.c_str(),
-                          std::ios::out | std::ios::trunc | std::ios::binary);
-        } else {
-          fileStream.open(fullFileName.c_str(),
-                          std::ios::out | std::ios::app | std::ios::binary);
-        }
-        if( ! fileStream.good()) {
-          amrex::FileOpenFailed(fullFileName);
-        }
+        OpenWriteFile(appendFirst);
         return true;
       } else {
         return false;
@@ -234,16 +512,7 @@ bool NFilesIter::ReadyToWrite(bool appendFirst) {
 
     for(int iSet(0); iSet < nSets; ++iSet) {
       if(mySetPosition == iSet) {
-        if(iSet == 0 && ! appendFirst) {   // ---- first set
-          fileStream.open(fullFileName.c_str(),
-                          std::ios::out | std::ios::trunc | std::ios::binary);
-        } else {
-          fileStream.open(fullFileName.c_str(),
-                          std::ios::out | std::ios::app | std::ios::binary);
-        }
-        if( ! fileStream.good()) {
-          amrex::FileOpenFailed(fullFileName);
-        }
+        OpenWriteFile( ! (iSet == 0 && ! appendFirst));  // ---- truncate for the first set
         return true;
       }
 
@@ -264,16 +533,7 @@ bool NFilesIter::ReadyToWrite(bool appendFirst) {
     if(mySetPosition == 0) {    // ---- return true, ready to write data
 
       fullFileName = amrex::Concatenate(filePrefix, fileNumber, minDigits);
-      if(appendFirst) {
-        fileStream.open(fullFileName.c_str(),
-                        std::ios::out | std::ios::app | std::ios::binary);
-      } else {
-        fileStream.open(fullFileName.c_str(),
-                        std::ios::out | std::ios::trunc | std::ios::binary);
-      }
-      if( ! fileStream.good()) {
-        amrex::FileOpenFailed(fullFileName);
-      }
+      OpenWriteFile(appendFirst);
       return true;
 
     } else if(myProc == deciderProc) {  // ---- this proc decides who decides
@@ -295,11 +555,7 @@ bool NFilesIter::ReadyToWrite(bool appendFirst) {
       coordinatorProc = rmess.pid();
       fullFileName = amrex::Concatenate(filePrefix, fileNumber, minDigits);
 
-      fileStream.open(fullFileName.c_str(),
-                      std::ios::out | std::ios::app | std::ios::binary);
-      if( ! fileStream.good()) {
-        amrex::FileOpenFailed(fullFileName);
-      }
+      OpenWriteFile(true);
       return true;
 
     }
@@ -312,11 +568,7 @@ bool NFilesIter::ReadyToWrite(bool appendFirst) {
   if(finishedWriting) {
     return false;
   }
-  fileStream.open(fullFileName.c_str(),
-                  std::ios::out | std::ios::trunc | std::ios::binary);
-  if( ! fileStream.good()) {
-    amrex::FileOpenFailed(fullFileName);
-  }
+  OpenWriteFile(false);
   return true;
 #endif
 }
@@ -364,15 +616,13 @@ NFilesIter &NFilesIter::operator++() {
       if(useSparseFPP) {
 
         if(mySparseFileNumber != -1) {
-          fileStream.flush();
-          fileStream.close();
+          CloseWriteFile();
         }
         finishedWriting = true;
 
       } else {  // ---- the general static set selection
 
-      fileStream.flush();
-      fileStream.close();
+      CloseWriteFile();
 
       int iBuff(0), wakeUpPID(-1);
       if(groupSets) {
@@ -394,8 +644,7 @@ NFilesIter &NFilesIter::operator++() {
 
       if(mySetPosition == 0) {    // ---- write data
 
-        fileStream.flush();
-        fileStream.close();
+        CloseWriteFile();
         finishedWriting = true;
 
         // ---- tell the decider we are done
@@ -465,8 +714,7 @@ NFilesIter &NFilesIter::operator++() {
       }
 
       if( ! finishedWriting) {  // ---- the deciderProc drops through to here
-        fileStream.flush();
-        fileStream.close();
+        CloseWriteFile();
         finishedWriting = true;
 
         // ---- signal we are finished
@@ -482,8 +730,7 @@ NFilesIter &NFilesIter::operator++() {
     fileStream.close();
     finishedReading = true;
   } else {  // ---- writing
-    fileStream.flush();
-    fileStream.close();
+    CloseWriteFile();
     finishedWriting = true;
   }
 #endif
@@ -493,6 +740,9 @@ NFilesIter &NFilesIter::operator++() {
 
 
 std::streampos NFilesIter::SeekPos() {
+  if(directWriter) {
+    return std::streampos(directWriter->Position());
+  }
   return fileStream.tellp();
 }
 
@@ -132,19 +132,36 @@ MultiFab
 PlotFileDataImpl::get (int level, std::string const& varname) noexcept
 {
     MultiFab mf(m_ba[level], m_dmap[level], 1, m_ngrow[level]);
+    int icomp = varIndex(varname);
+    for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        m_vismf[level]->readRegion(mfi.index(), icomp, 1, mfi.fabbox(), mf[mfi]);
+    }
+    return mf;
+}
+
+MultiFab
+PlotFileDataImpl::get (int level, std::string const& varname, Box const& region) noexcept
+{
+    MultiFab mf(m_ba[level], m_dmap[level], 1, m_ngrow[level]);
+    mf.setVal(0.0);
+    int icomp = varIndex(varname);
+    for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        const Box& bx = mfi.fabbox() & region;
+        if (bx.ok()) {
+            m_vismf[level]->readRegion(mfi.index(), icomp, 1, bx, mf[mfi]);
+        }
+    }
+    return mf;
+}
+
+int
+PlotFileDataImpl::varIndex (std::string const& varname) const
+{
     auto r = std::find(std::begin(m_var_names), std::end(m_var_names), varname);
     if (r == std::end(m_var_names)) {
         amrex::Abort("PlotFileDataImpl::get: varname not found "+varname);
-    } else {
-        int icomp = static_cast<int>(std::distance(std::begin(m_var_names), r));
-        for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
-            int gid = mfi.index();
-            FArrayBox& dstfab = mf[mfi];
-            std::unique_ptr<FArrayBox> srcfab(m_vismf[level]->readFAB(gid, icomp));
-            dstfab.copy<RunOn::Host>(*srcfab);
-        }
     }
-    return mf;
+    return static_cast<int>(std::distance(std::begin(m_var_names), r));
 }
 
 }
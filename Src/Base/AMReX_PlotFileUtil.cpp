@@ -177,6 +177,8 @@ WriteMultiLevelPlotfile (const std::string& plotfilename, int nlevels,
 
     int finest_level = nlevels-1;
 
+    AsyncOut::ScopedStream async_stream(AsyncOut::PlotfileStream);
+
     bool callBarrier(false);
     PreBuildDirectorHierarchy(plotfilename, levelPrefix, nlevels, callBarrier);
     if (!extra_dirs.empty()) {
@@ -234,7 +236,8 @@ WriteMultiLevelPlotfile (const std::string& plotfilename, int nlevels,
             } else {
                 data = mf[level];
             }
-            VisMF::Write(*data, MultiFabFileFullPrefix(level, plotfilename, levelPrefix, mfPrefix));
+            VisMF::Write(*data, MultiFabFileFullPrefix(level, plotfilename, levelPrefix, mfPrefix),
+                         VisMF::NFiles, false, VisMF::GetPlotfileErrorBound());
         }
     }
 }
@@ -450,7 +453,8 @@ EB_WriteMultiLevelPlotfile (const std::string& plotfilename, int nlevels,
         MultiFab::Copy(mf_tmp, *mf[level], 0, 0, nc, 0);
         auto const& factory = dynamic_cast<EBFArrayBoxFactory const&>(mf[level]->Factory());
         MultiFab::Copy(mf_tmp, factory.getVolFrac(), 0, nc, 1, 0);
-        VisMF::Write(mf_tmp, MultiFabFileFullPrefix(level, plotfilename, levelPrefix, mfPrefix));
+        VisMF::Write(mf_tmp, MultiFabFileFullPrefix(level, plotfilename, levelPrefix, mfPrefix),
+                     VisMF::NFiles, false, VisMF::GetPlotfileErrorBound());
     }
 
 //    VisMF::SetNOutFiles(saveNFiles);
@@ -489,8 +489,29 @@ TinyProfiler::MemoryFinalize (bool bFlushing) noexcept
     int ioproc = ParallelDescriptor::IOProcessorNumber();
     ParallelReduce::Max(dt_max, ioproc, ParallelDescriptor::Communicator());
 
+    // An arena may register more than one map under the same name (e.g.,
+    // one for each per-thread cache of CArena).  They are combined here.
+    // Note that MaxMem is then the sum of the maxima of the maps.
+    std::vector<std::string> memnames;
+    std::map<std::string, std::map<std::string, MemStat>> combined;
     for (std::size_t i = 0; i < all_memstats.size(); ++i) {
-        PrintMemStats(*(all_memstats[i]), all_memnames[i], dt_max, t_final);
+        auto& cm = combined[all_memnames[i]];
+        if (std::find(memnames.begin(), memnames.end(), all_memnames[i]) == memnames.end()) {
+            memnames.push_back(all_memnames[i]);
+        }
+        for (auto const& kv : *(all_memstats[i])) {
+            auto& st = cm[kv.first];
+            st.nalloc += kv.second.nalloc;
+            st.nfree += kv.second.nfree;
+            st.currentmem += kv.second.currentmem;
+            st.avgmem += kv.second.avgmem;
+            st.maxmem += kv.second.maxmem;
+            st.ncached += kv.second.ncached;
+        }
+    }
+
+    for (auto const& memname : memnames) {
+        PrintMemStats(combined[memname], memname, dt_max, t_final);
     }
 
     if (!bFlushing) {
@@ -758,11 +779,13 @@ TinyProfiler::PrintMemStats(std::map<std::string, MemStat>& memstats,
         Long avgmem = static_cast<Long>(
             (it.second.avgmem + static_cast<double>(it.second.currentmem) * t_final) / dt_max);
         Long maxmem = it.second.maxmem;
+        Long ncached = it.second.ncached;
 
         std::vector<Long> nalloc_vec(nprocs);
         std::vector<Long> nfree_vec(nprocs);
         std::vector<Long> avgmem_vec(nprocs);
         std::vector<Long> maxmem_vec(nprocs);
+        std::vector<Long> ncached_vec(nprocs);
 
         if (nprocs == 1)
         {
@@ -770,12 +793,14 @@ TinyProfiler::PrintMemStats(std::map<std::string, MemStat>& memstats,
             nfree_vec[0] = nfree;
             avgmem_vec[0] = avgmem;
             maxmem_vec[0] = maxmem;
+            ncached_vec[0] = ncached;
         } else
         {
             ParallelDescriptor::Gather(&nalloc, 1, &nalloc_vec[0], 1, ioproc);
             ParallelDescriptor::Gather(&nfree, 1, &nfree_vec[0], 1, ioproc);
             ParallelDescriptor::Gather(&maxmem, 1, &maxmem_vec[0], 1, ioproc);
             ParallelDescriptor::Gather(&avgmem, 1, &avgmem_vec[0], 1, ioproc);
+            ParallelDescriptor::Gather(&ncached, 1, &ncached_vec[0], 1, ioproc);
         }
 
         if (ParallelDescriptor::IOProcessor()) {
@@ -784,6 +809,7 @@ TinyProfiler::PrintMemStats(std::map<std::string, MemStat>& memstats,
 
                 pst.nalloc += nalloc_vec[i];
                 pst.nfree += nfree_vec[i];
+                pst.ncached += ncached_vec[i];
                 pst.avgmem_min = std::min(pst.avgmem_min, avgmem_vec[i]);
                 pst.avgmem_avg += avgmem_vec[i];
                 pst.avgmem_max = std::max(pst.avgmem_max, avgmem_vec[i]);
@@ -802,6 +828,13 @@ TinyProfiler::PrintMemStats(std::map<std::string, MemStat>& memstats,
 
     std::vector<std::vector<std::string>> allstatsstr;
 
+    // Only show the number of allocations served by per-thread caches if
+    // there are any.
+    bool has_cached = false;
+    for (auto const& stat : allprocstats) {
+        has_cached = has_cached || (stat.ncached > 0);
+    }
+
     if (nprocs == 1) {
         allstatsstr.push_back({"Name", "Nalloc", "Nfree", "AvgMem", "MaxMem"});
     } else {
@@ -809,6 +842,9 @@ TinyProfiler::PrintMemStats(std::map<std::string, MemStat>& memstats,
                                "AvgMem min", "AvgMem avg", "AvgMem max",
                                "MaxMem min", "MaxMem avg", "MaxMem max"});
     }
+    if (has_cached) {
+        allstatsstr[0].insert(allstatsstr[0].begin()+3, "Ncached");
+    }
 
     auto mem_to_string = [] (Long nbytes) {
         std::string unit = "   B";
@@ -850,6 +886,10 @@ TinyProfiler::PrintMemStats(std::map<std::string, MemStat>& memstats,
                                     mem_to_string(stat.maxmem_avg),
                                     mem_to_string(stat.maxmem_max)});
             }
+            if (has_cached) {
+                allstatsstr.back().insert(allstatsstr.back().begin()+3,
+                                          std::to_string(stat.ncached));
+            }
         }
     }
 
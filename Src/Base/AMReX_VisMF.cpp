@@ -1,12 +1,17 @@
 
 #include <AMReX_FabArrayUtility.H>
+#include <AMReX_FileSystem.H>
 #include <AMReX_FPC.H>
 #include <AMReX_ParmParse.H>
 #include <AMReX_Utility.H>
 #include <AMReX_VisMF.H>
+#include <AMReX_VisMFCompress.H>
 
+#include <array>
 #include <cerrno>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <limits>
 
 namespace amrex {
@@ -14,15 +19,19 @@ namespace amrex {
 static const char *TheMultiFabHdrFileSuffix = "_H";
 static const char *FabFileSuffix = "_D_";
 static const char *TheFabOnDiskPrefix = "FabOnDisk:";
+static const char *TheFabHashFileSuffix = "_Hash";
 
 std::map<std::string, VisMF::PersistentIFStream> VisMF::persistentIFStreams;
 
 int VisMF::verbose(0);
 VisMF::Header::Version VisMF::currentVersion(VisMF::Header::Version_v1);
+Real VisMF::plotfileErrorBound(0);
 bool VisMF::groupSets(false);
 bool VisMF::setBuf(true);
 bool VisMF::useSingleRead(false);
 bool VisMF::useSingleWrite(false);
+bool VisMF::useDirectWrite(false);
+int VisMF::directWriteThreads(4);
 bool VisMF::checkFilePositions(false);
 bool VisMF::usePersistentIFStreams(false);
 bool VisMF::useSynchronousReads(false);
@@ -41,22 +50,196 @@ namespace
 {
     bool initialized = false;
 
-#ifdef AMREX_USE_MPI
-    void NItemsPerBin (int totalItems, Vector<int> &binCounts)
+    bool isCompressed (int vers)
     {
-        if(binCounts.empty()) {
+        return vers == VisMF::Header::Compressed_v1 || vers == VisMF::Header::Compressed_v2;
+    }
+
+    Long compressedFabBytes (const VisMF::Header& hdr, int idx)
+    {
+        Long nbytes(0);
+        for(auto n : hdr.m_comp_bytes[idx]) {
+            nbytes += n;
+        }
+        return nbytes;
+    }
+
+    // ---- src points to the first block of the fab.  Decodes components
+    // ---- [icomp,icomp+ncomp) into data.
+    void decompressFAB (char const* src, const VisMF::Header& hdr, int idx,
+                        int icomp, int ncomp, Real* data, Long npts)
+    {
+        auto const& comp_bytes = hdr.m_comp_bytes[idx];
+        if(hdr.m_vers == VisMF::Header::Compressed_v1) {
+            // ---- a single block holds all components
+            if(icomp == 0 && ncomp == hdr.m_ncomp) {
+                VisMFCompress::DecompressFab(src, comp_bytes[0], hdr.m_writtenRD,
+                                             data, npts * ncomp);
+            } else {
+                Vector<Real> tmp(npts * hdr.m_ncomp);
+                VisMFCompress::DecompressFab(src, comp_bytes[0], hdr.m_writtenRD,
+                                             tmp.data(), npts * hdr.m_ncomp);
+                std::memcpy(data, tmp.data() + npts * icomp, npts * ncomp * sizeof(Real));
+            }
             return;
         }
-        int countForAll = static_cast<int>(totalItems / binCounts.size());
-        int remainder = static_cast<int>(totalItems % binCounts.size());
-        for(int i(0); i < binCounts.size(); ++i) {
-            binCounts[i] = countForAll;
+        for(int n(0); n < icomp; ++n) {
+            src += comp_bytes[n];
+        }
+        for(int n(icomp); n < icomp + ncomp; ++n) {
+            VisMFCompress::DecompressFab(src, comp_bytes[n], hdr.m_writtenRD,
+                                         data + (n - icomp) * npts, npts);
+            src += comp_bytes[n];
+        }
+    }
+
+    // ---- is must be at the start of the fab.  Reads components
+    // ---- [icomp,icomp+ncomp) into data, skipping the blocks of the
+    // ---- other components if they are stored separately.
+    void readCompressedFAB (std::istream& is, const VisMF::Header& hdr, int idx,
+                            int icomp, int ncomp, Real* data, Long npts)
+    {
+        auto const& comp_bytes = hdr.m_comp_bytes[idx];
+        Vector<char> block;
+        if(hdr.m_vers == VisMF::Header::Compressed_v1) {
+            block.resize(comp_bytes[0]);
+            is.read(block.data(), static_cast<std::streamsize>(comp_bytes[0]));
+            decompressFAB(block.data(), hdr, idx, icomp, ncomp, data, npts);
+            return;
+        }
+        Long skip(0);
+        for(int n(0); n < icomp; ++n) {
+            skip += comp_bytes[n];
+        }
+        if(skip > 0) {
+            is.seekg(skip, std::ios::cur);
         }
-        for(int i(0); i < remainder; ++i) {
-            ++binCounts[i];
+        for(int n(icomp); n < icomp + ncomp; ++n) {
+            block.resize(comp_bytes[n]);
+            is.read(block.data(), static_cast<std::streamsize>(comp_bytes[n]));
+            VisMFCompress::DecompressFab(block.data(), comp_bytes[n], hdr.m_writtenRD,
+                                         data + (n - icomp) * npts, npts);
         }
     }
+
+    std::uint64_t rotl64 (std::uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    std::uint64_t fmix64 (std::uint64_t k)
+    {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+
+    // ---- MurmurHash3 x64_128 of the fab data, ghost cells included.  Each
+    // ---- word is mixed before it is combined, so changes cannot cancel.
+    std::array<std::uint64_t,2> hashFAB (const FArrayBox& fab)
+    {
+        Real const* data = fab.dataPtr();
+#ifdef AMREX_USE_GPU
+        std::unique_ptr<FArrayBox> hostfab;
+        if (fab.arena()->isManaged() || fab.arena()->isDevice()) {
+            hostfab = std::make_unique<FArrayBox>(fab.box(), fab.nComp(), The_Pinned_Arena());
+            Gpu::dtoh_memcpy_async(hostfab->dataPtr(), fab.dataPtr(), fab.size()*sizeof(Real));
+            Gpu::streamSynchronize();
+            data = hostfab->dataPtr();
+        }
 #endif
+        constexpr std::uint64_t c1(0x87c37b91114253d5ULL);
+        constexpr std::uint64_t c2(0x4cf5ad432745937fULL);
+        auto const* p = reinterpret_cast<unsigned char const*>(data);
+        const Long nbytes(fab.nBytes());
+        std::uint64_t h1(0), h2(0);
+        Long i(0);
+        for( ; i + 16 <= nbytes; i += 16) {
+            std::uint64_t k1, k2;
+            std::memcpy(&k1, p + i, 8);
+            std::memcpy(&k2, p + i + 8, 8);
+            k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+            h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+            k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+            h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+        }
+        // ---- the last 0 to 15 bytes
+        std::uint64_t k1(0), k2(0);
+        for(Long j(i); j < nbytes; ++j) {
+            const int shift(static_cast<int>(8 * ((j - i) % 8)));
+            if(j - i < 8) {
+                k1 ^= std::uint64_t(p[j]) << shift;
+            } else {
+                k2 ^= std::uint64_t(p[j]) << shift;
+            }
+        }
+        if(nbytes - i > 8) {
+            k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        }
+        if(nbytes - i > 0) {
+            k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        }
+        h1 ^= static_cast<std::uint64_t>(nbytes);
+        h2 ^= static_cast<std::uint64_t>(nbytes);
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix64(h1);
+        h2 = fmix64(h2);
+        h1 += h2;
+        h2 += h1;
+        return {h1, h2};
+    }
+
+    Vector<std::string> pathComponents (const std::string& path)
+    {
+        Vector<std::string> comps;
+        std::istringstream is(path);
+        std::string c;
+        while(std::getline(is, c, '/')) {
+            if(c.empty() || c == ".") {
+                continue;
+            }
+            if(c == ".." && ! comps.empty() && comps.back() != "..") {
+                comps.pop_back();
+            } else {
+                comps.push_back(c);
+            }
+        }
+        return comps;
+    }
+
+    // ---- the name of file relative to directory dir.  Relative paths are
+    // ---- taken relative to the current directory, so the two may be mixed.
+    std::string relativePath (const std::string& file, const std::string& dir)
+    {
+        auto absolutePath = [] (const std::string& path) -> std::string {
+            if( ! path.empty() && path[0] == '/') {
+                return path;
+            }
+            return FileSystem::CurrentPath() + '/' + path;
+        };
+        auto f = pathComponents(absolutePath(file));
+        auto d = pathComponents(absolutePath(dir));
+        Long n(0);
+        while(n + 1 < f.size() && n < d.size() && f[n] == d[n]) {
+            ++n;
+        }
+        std::string rel;
+        for(Long i(n); i < d.size(); ++i) {
+            rel += "../";
+        }
+        for(Long i(n); i < f.size(); ++i) {
+            rel += f[i];
+            if(i + 1 < f.size()) {
+                rel += '/';
+            }
+        }
+        return rel;
+    }
+
 }
 
 void
@@ -82,11 +265,14 @@ VisMF::Initialize ()
     if(headerVersion != currentVersion) {
       currentVersion = static_cast<VisMF::Header::Version> (headerVersion);
     }
+    pp.queryAdd("plotfile_error_bound", plotfileErrorBound);
 
     pp.queryAdd("groupsets", groupSets);
     pp.queryAdd("setbuf", setBuf);
     pp.queryAdd("usesingleread", useSingleRead);
     pp.queryAdd("usesinglewrite", useSingleWrite);
+    pp.queryAdd("usedirectwrite", useDirectWrite);
+    pp.queryAdd("directwritethreads", directWriteThreads);
     pp.queryAdd("checkfilepositions", checkFilePositions);
     pp.queryAdd("usepersistentifstreams", usePersistentIFStreams);
     pp.queryAdd("usesynchronousreads", useSynchronousReads);
@@ -297,7 +483,9 @@ operator<< (std::ostream        &os,
       os << hd.m_max      << '\n';
     }
 
-    if(hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1) {
+    if(hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1 ||
+       isCompressed(hd.m_vers))
+    {
       BL_ASSERT(hd.m_famin.size() == hd.m_ncomp);
       BL_ASSERT(hd.m_famin.size() == hd.m_famax.size());
       for(int i(0); i < hd.m_famin.size(); ++i) {
@@ -312,7 +500,8 @@ operator<< (std::ostream        &os,
 
     if(hd.m_vers == VisMF::Header::NoFabHeader_v1       ||
        hd.m_vers == VisMF::Header::NoFabHeaderMinMax_v1 ||
-       hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1)
+       hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1 ||
+       isCompressed(hd.m_vers))
     {
       if(FArrayBox::getFormat() == FABio::FAB_NATIVE) {
         os << FPC::NativeRealDescriptor() << '\n';
@@ -323,6 +512,27 @@ operator<< (std::ostream        &os,
       }
     }
 
+    if(hd.m_vers == VisMF::Header::Compressed_v1) {
+      BL_ASSERT(hd.m_comp_bytes.size() == hd.m_ba.size());
+      os << hd.m_error_bound << '\n';
+      os << hd.m_comp_bytes.size();
+      for(auto const& comp_bytes : hd.m_comp_bytes) {
+        os << ' ' << comp_bytes[0];
+      }
+      os << '\n';
+    }
+
+    if(hd.m_vers == VisMF::Header::Compressed_v2) {
+      BL_ASSERT(hd.m_comp_bytes.size() == hd.m_ba.size());
+      os << hd.m_error_bound << '\n';
+      os << hd.m_comp_bytes.size() << ',' << hd.m_ncomp << '\n';
+      for(auto const& comp_bytes : hd.m_comp_bytes) {
+        for(int n(0); n < hd.m_ncomp; ++n) {
+          os << comp_bytes[n] << (n == hd.m_ncomp - 1 ? '\n' : ' ');
+        }
+      }
+    }
+
     os.flags(oflags);
     os.precision(oldPrec);
 
@@ -383,7 +593,9 @@ operator>> (std::istream  &is,
       BL_ASSERT(hd.m_ba.size() == hd.m_max.size());
     }
 
-    if(hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1) {
+    if(hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1 ||
+       isCompressed(hd.m_vers))
+    {
       char ch;
       AMREX_ASSERT(hd.m_ncomp >= 0 && hd.m_ncomp < std::numeric_limits<int>::max());
       hd.m_famin.resize(hd.m_ncomp);
@@ -403,11 +615,42 @@ operator>> (std::istream  &is,
     }
     if(hd.m_vers == VisMF::Header::NoFabHeader_v1       ||
        hd.m_vers == VisMF::Header::NoFabHeaderMinMax_v1 ||
-       hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1)
+       hd.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1 ||
+       isCompressed(hd.m_vers))
     {
       is >> hd.m_writtenRD;
     }
 
+    if(hd.m_vers == VisMF::Header::Compressed_v1) {
+      // ---- one block per fab
+      is >> hd.m_error_bound;
+      Long nfabs;
+      is >> nfabs;
+      BL_ASSERT(nfabs == hd.m_ba.size());
+      hd.m_comp_bytes.resize(nfabs);
+      for(auto& comp_bytes : hd.m_comp_bytes) {
+        comp_bytes.resize(1);
+        is >> comp_bytes[0];
+      }
+    }
+
+    if(hd.m_vers == VisMF::Header::Compressed_v2) {
+      // ---- one block per component of each fab
+      is >> hd.m_error_bound;
+      Long nfabs;
+      int ncomp;
+      char ch;
+      is >> nfabs >> ch >> ncomp;
+      BL_ASSERT(nfabs == hd.m_ba.size() && ch == ',' && ncomp == hd.m_ncomp);
+      hd.m_comp_bytes.resize(nfabs);
+      for(auto& comp_bytes : hd.m_comp_bytes) {
+        comp_bytes.resize(ncomp);
+        for(auto& nbytes : comp_bytes) {
+          is >> nbytes;
+        }
+      }
+    }
+
 
     if( ! is.good()) {
         amrex::Error("Read of VisMF::Header failed");
@@ -555,6 +798,126 @@ VisMF::readFAB (int idx, int icomp)
     return VisMF::readFAB(idx, m_fafabname, m_hdr, icomp);
 }
 
+void
+VisMF::readRegion (int fabIndex, int icomp, int ncomp, const Box& region,
+                   FArrayBox& fab, int dcomp) const
+{
+    BL_PROFILE("VisMF::readRegion()");
+    BL_ASSERT(0 <= fabIndex && fabIndex < m_hdr.m_ba.size());
+    BL_ASSERT(0 <= icomp && icomp+ncomp <= m_hdr.m_ncomp);
+    BL_ASSERT(0 <= dcomp && dcomp+ncomp <= fab.nComp());
+
+    Box fab_box(m_hdr.m_ba[fabIndex]);
+    if(m_hdr.m_ngrow.max() > 0) {
+        fab_box.grow(m_hdr.m_ngrow);
+    }
+    AMREX_ALWAYS_ASSERT(fab_box.contains(region) && fab.box().contains(region));
+
+    FArrayBox* dstfab = &fab;
+    int dstcomp = dcomp;
+#ifdef AMREX_USE_GPU
+    std::unique_ptr<FArrayBox> hostfab;
+    if (fab.arena()->isManaged() || fab.arena()->isDevice()) {
+        hostfab = std::make_unique<FArrayBox>(region, ncomp, The_Pinned_Arena());
+        dstfab = hostfab.get();
+        dstcomp = 0;
+    }
+#endif
+
+    std::string FullName(VisMF::DirName(m_fafabname));
+    FullName += m_hdr.m_fod[fabIndex].m_name;
+    auto& mfile = m_mapped_files[FullName];
+    if (mfile == nullptr) {
+        mfile = std::make_unique<MappedFile>(FullName);
+    }
+
+    // ---- a truncated or corrupt file must not make us read past the map
+    auto checkRange = [&] (Long begin, Long nbytes) {
+        if(begin < 0 || nbytes < 0 || begin + nbytes > mfile->size()) {
+            amrex::Error("VisMF::readRegion: " + FullName + " is too short for fab "
+                         + std::to_string(fabIndex));
+        }
+    };
+
+    Long offset = m_hdr.m_fod[fabIndex].m_head;
+    RealDescriptor rd(m_hdr.m_writtenRD);
+    bool oldFabHeader(false);
+
+    if(m_hdr.m_vers == Header::Version_v1) {
+        checkRange(offset, 0);
+        // ---- the fab header is a single line:  FAB rd box ncomp
+        auto const* eol = static_cast<char const*>(std::memchr(mfile->data() + offset, '\n',
+                                                               mfile->size() - offset));
+        if(eol == nullptr) {
+            amrex::Error("VisMF::readRegion: bad fab header in " + FullName);
+        }
+        std::istringstream is(std::string(mfile->data() + offset, eol));
+        char c[4];
+        is >> c[0] >> c[1] >> c[2] >> c[3];
+        if(c[3] == ':') {
+            oldFabHeader = true;
+        } else {
+            is.putback(c[3]);
+            is >> rd;
+        }
+        offset = eol + 1 - mfile->data();
+    }
+
+    if(oldFabHeader) {
+        // ---- the whole fab has to be read
+        std::unique_ptr<FArrayBox> f(VisMF::readFAB(fabIndex, m_fafabname, m_hdr, -1));
+        dstfab->copy<RunOn::Host>(*f, region, icomp, region, dstcomp, ncomp);
+    } else if(isCompressed(m_hdr.m_vers)) {
+        // ---- with Compressed_v2 only the blocks of the needed components are decoded
+        checkRange(offset, compressedFabBytes(m_hdr, fabIndex));
+        FArrayBox tmp(fab_box, ncomp, The_Cpu_Arena());
+        decompressFAB(mfile->data() + offset, m_hdr, fabIndex, icomp, ncomp,
+                      tmp.dataPtr(), fab_box.numPts());
+        dstfab->copy<RunOn::Host>(tmp, region, 0, region, dstcomp, ncomp);
+    } else {
+        const int nbytes(rd.numBytes());
+        const bool native(rd == FPC::NativeRealDescriptor());
+        const Long npts(fab_box.numPts());
+        const auto len = fab_box.length3d();
+        const auto flo = amrex::lbound(fab_box);
+        const auto rlo = amrex::lbound(region);
+        const auto rhi = amrex::ubound(region);
+        const Long nx(rhi.x - rlo.x + 1);
+        auto cellOffset = [&] (int i, int j, int k) -> Long {
+            return (i - flo.x) + Long(j - flo.y) * len[0] + Long(k - flo.z) * len[0] * len[1];
+        };
+        auto const& dst = dstfab->array();
+
+        for(int n(0); n < ncomp; ++n) {
+            const Long compOffset = offset + (icomp + n) * npts * nbytes;
+            // ---- read ahead only if most of the span is needed
+            const Long span = cellOffset(rhi.x, rhi.y, rhi.z) - cellOffset(rlo.x, rlo.y, rlo.z) + 1;
+            checkRange(compOffset + cellOffset(rlo.x, rlo.y, rlo.z) * nbytes, span * nbytes);
+            if(2 * region.numPts() >= span) {
+                mfile->willNeed(compOffset + cellOffset(rlo.x, rlo.y, rlo.z) * nbytes, span * nbytes);
+            }
+            for(int k(rlo.z); k <= rhi.z; ++k) {
+                for(int j(rlo.y); j <= rhi.y; ++j) {
+                    char const* src = mfile->data() + compOffset + cellOffset(rlo.x, j, k) * nbytes;
+                    Real* p = dst.ptr(rlo.x, j, k, dstcomp + n);
+                    if(native) {
+                        std::memcpy(p, src, nx * sizeof(Real));
+                    } else {
+                        RealDescriptor::convertToNativeFormat(p, nx, const_cast<char*>(src), rd);
+                    }
+                }
+            }
+        }
+    }
+
+#ifdef AMREX_USE_GPU
+    if (hostfab) {
+        fab.copy<RunOn::Device>(*hostfab, region, 0, region, dcomp, ncomp);
+        Gpu::streamSynchronize();
+    }
+#endif
+}
+
 std::string
 VisMF::BaseName (const std::string& filename)
 {
@@ -650,6 +1013,12 @@ VisMF::Header::Header (const FabArray<FArrayBox>& mf,
 {
 //    BL_PROFILE("VisMF::Header");
 
+    if(version == Compressed_v1) {
+      m_comp_bytes.resize(m_ba.size(), Vector<Long>(1, 0));
+    } else if(version == Compressed_v2) {
+      m_comp_bytes.resize(m_ba.size(), Vector<Long>(m_ncomp, 0));
+    }
+
     if(version == NoFabHeader_v1) {
       m_min.clear();
       m_max.clear();
@@ -662,7 +1031,7 @@ VisMF::Header::Header (const FabArray<FArrayBox>& mf,
         && (mf.arena()->isManaged() || mf.arena()->isDevice());
     amrex::ignore_unused(run_on_device);
 
-    if(version == NoFabHeaderFAMinMax_v1) {
+    if(version == NoFabHeaderFAMinMax_v1 || isCompressed(version)) {
       // ---- calculate FabArray min max values only
       m_min.clear();
       m_max.clear();
@@ -931,7 +1300,8 @@ Long
 VisMF::Write (const FabArray<FArrayBox>&    mf,
               const std::string& mf_name,
               VisMF::How         how,
-              bool               set_ghost)
+              bool               set_ghost,
+              Real               error_bound)
 {
     BL_PROFILE("VisMF::Write(FabArray)");
     BL_ASSERT(mf_name[mf_name.length() - 1] != '/');
@@ -996,12 +1366,68 @@ VisMF::Write (const FabArray<FArrayBox>&    mf,
 
     bool oldHeader(currentVersion == VisMF::Header::Version_v1);
 
+    // ---- compress before the nfiles loop so all ranks compress concurrently
+    bool compressed(isCompressed(currentVersion));
+    Vector<Vector<char>> compressedFabs;
+    if(compressed) {
+        BL_PROFILE("VisMF::Write:compress");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(FArrayBox::getFormat() != FABio::FAB_ASCII &&
+                                         FArrayBox::getFormat() != FABio::FAB_8BIT,
+                                         "VisMF::Write: compressed headers require a binary fab format");
+        hdr.m_error_bound = error_bound;
+        compressedFabs.resize(mf.local_size());
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for(MFIter mfi(mf); mfi.isValid(); ++mfi) {
+            const FArrayBox &fab = mf[mfi];
+            Real const* fabdata = fab.dataPtr();
+#ifdef AMREX_USE_GPU
+            std::unique_ptr<FArrayBox> hostfab;
+            if (fab.arena()->isManaged() || fab.arena()->isDevice()) {
+                hostfab = std::make_unique<FArrayBox>(fab.box(), fab.nComp(),
+                                                      The_Pinned_Arena());
+                Gpu::dtoh_memcpy_async(hostfab->dataPtr(), fab.dataPtr(),
+                                       fab.size()*sizeof(Real));
+                Gpu::streamSynchronize();
+                fabdata = hostfab->dataPtr();
+            }
+#endif
+            const Long npts(fab.box().numPts());
+            auto& fabblocks = compressedFabs[mfi.LocalIndex()];
+            if(currentVersion == VisMF::Header::Compressed_v1) {
+                VisMFCompress::CompressFab(fabdata, npts * mf.nComp(), *whichRD, error_bound, fabblocks);
+                hdr.m_comp_bytes[mfi.index()][0] = static_cast<Long>(fabblocks.size());
+                continue;
+            }
+            // ---- one block per component, so a component can be read alone
+            Vector<char> block;
+            for(int n(0); n < mf.nComp(); ++n) {
+                VisMFCompress::CompressFab(fabdata + n * npts, npts, *whichRD, error_bound, block);
+                fabblocks.insert(fabblocks.end(), block.begin(), block.end());
+                hdr.m_comp_bytes[mfi.index()][n] = static_cast<Long>(block.size());
+            }
+        }
+    }
+
     if(useSparseFPP) {
         nfi.SetSparseFPP(procsWithDataVector);
     } else if(useDynamicSetSelection) {
         nfi.SetDynamic();
     }
+    if(useDirectWrite) {
+        nfi.SetDirectWrite(directWriteThreads);
+    }
     for( ; nfi.ReadyToWrite(); ++nfi) {
+        if(compressed) {
+            for(MFIter mfi(mf); mfi.isValid(); ++mfi) {
+                auto const& block = compressedFabs[mfi.LocalIndex()];
+                nfi.Write(block.data(), static_cast<Long>(block.size()));
+                bytesWritten += static_cast<Long>(block.size());
+            }
+            continue;
+        }
+
         // ---- find the total number of bytes including fab headers if needed
         const FABio &fio = FArrayBox::getFABio();
         int whichRDBytes(whichRD->numBytes()), nFABs(0);
@@ -1018,7 +1444,8 @@ VisMF::Write (const FabArray<FArrayBox>&    mf,
         }
         char *allFabData(nullptr);
         bool canCombineFABs(false);
-        if((nFABs > 1 || doConvert) && VisMF::useSingleWrite) {
+        // ---- the direct writer copies the fabs, so they are not combined first
+        if((nFABs > 1 || doConvert) && VisMF::useSingleWrite && ! nfi.GetDirectWrite()) {
             allFabData = new(std::nothrow) char[bytesWritten];
         }    // ---- else { no need to make a copy for one fab }
         if(allFabData == nullptr) {
@@ -1063,8 +1490,7 @@ VisMF::Write (const FabArray<FArrayBox>&    mf,
                 }
                 writePosition += hLength + writeDataSize;
             }
-            nfi.Stream().write(allFabData, bytesWritten);
-            nfi.Stream().flush();
+            nfi.Write(allFabData, bytesWritten);
             delete [] allFabData;
 
         } else {    // ---- write fabs individually
@@ -1078,8 +1504,7 @@ VisMF::Write (const FabArray<FArrayBox>&    mf,
                     fio.write_header(hss, fab, fab.nComp());
                     hLength = static_cast<std::streamoff>(hss.tellp());
                     auto tstr = hss.str();
-                    nfi.Stream().write(tstr.c_str(), hLength);    // ---- the fab header
-                    nfi.Stream().flush();
+                    nfi.Write(tstr.c_str(), hLength);    // ---- the fab header
                 }
                 Real const* fabdata = fab.dataPtr();
 #ifdef AMREX_USE_GPU
@@ -1098,12 +1523,10 @@ VisMF::Write (const FabArray<FArrayBox>&    mf,
                     RealDescriptor::convertFromNativeFormat(static_cast<void *> (cDataPtr),
                                                             writeDataItems,
                                                             fabdata, *whichRD);
-                    nfi.Stream().write(cDataPtr, writeDataSize);
-                    nfi.Stream().flush();
+                    nfi.Write(cDataPtr, writeDataSize);
                     delete [] cDataPtr;
                 } else {    // ---- copy from the fab
-                    nfi.Stream().write((char *) fabdata, writeDataSize);
-                    nfi.Stream().flush();
+                    nfi.Write((char *) fabdata, writeDataSize);
                 }
             }
         }
@@ -1128,6 +1551,155 @@ VisMF::Write (const FabArray<FArrayBox>&    mf,
 }
 
 
+Long
+VisMF::WriteDelta (const FabArray<FArrayBox>& mf,
+                   const std::string& mf_name,
+                   const std::string& ref_name,
+                   VisMF::How         how)
+{
+    BL_PROFILE("VisMF::WriteDelta()");
+    BL_ASSERT(mf_name[mf_name.length() - 1] != '/');
+
+    const int nfabs(mf.size());
+    const int ioProc(ParallelDescriptor::IOProcessorNumber());
+
+    // ---- hash the local fabs, then share the hashes.  Two words per fab.
+    Vector<std::uint64_t> hashes(2 * nfabs, 0);
+    for(MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        auto h = hashFAB(mf[mfi]);
+        hashes[2 * mfi.index()]     = h[0];
+        hashes[2 * mfi.index() + 1] = h[1];
+    }
+#ifdef BL_USE_MPI
+    BL_MPI_REQUIRE( MPI_Allreduce(MPI_IN_PLACE, hashes.dataPtr(), 2 * nfabs, MPI_UINT64_T,
+                                  MPI_BOR, ParallelDescriptor::Communicator()) );
+#endif
+
+    // ---- the reference header and hashes, if they exist and match mf
+    VisMF::Header refHdr;
+    Vector<std::uint64_t> refHashes;
+    if( ! ref_name.empty()) {
+        Vector<char> hashBuf, hdrBuf;
+        ParallelDescriptor::ReadAndBcastFile(ref_name + TheFabHashFileSuffix, hashBuf, false);
+        if( ! hashBuf.empty()) {
+            ParallelDescriptor::ReadAndBcastFile(ref_name + TheMultiFabHdrFileSuffix, hdrBuf);
+            std::istringstream his(hdrBuf.dataPtr(), std::istringstream::in);
+            his >> refHdr;
+            std::istringstream is(hashBuf.dataPtr(), std::istringstream::in);
+            int n(0);
+            is >> n;
+            refHashes.resize(n);
+            for(auto& h : refHashes) {
+                is >> std::hex >> h;
+            }
+        }
+    }
+    bool useRef = ! refHashes.empty()
+        && refHashes.size() == 2 * nfabs
+        && refHdr.m_vers == currentVersion
+        && refHdr.m_ncomp == mf.nComp()
+        && refHdr.m_ngrow == mf.nGrowVect()
+        && refHdr.m_ba == mf.boxArray();
+    if(useRef && NoFabHeader(refHdr)) {
+        useRef = (refHdr.m_writtenRD == *FArrayBox::getDataDescriptor());
+    }
+
+    Vector<int> changed;
+    for(int i(0); i < nfabs; ++i) {
+        if( ! useRef || hashes[2 * i] != refHashes[2 * i] || hashes[2 * i + 1] != refHashes[2 * i + 1]) {
+            changed.push_back(i);
+        }
+    }
+
+    Long bytesWritten(0);
+
+    if(changed.size() == nfabs) {
+        bytesWritten += VisMF::Write(mf, mf_name, how);
+    } else {
+        // ---- write the changed fabs as their own FabArray
+        VisMF::Header changedHdr;
+        if( ! changed.empty()) {
+            const Vector<int>& pmap = mf.DistributionMap().ProcessorMap();
+            BoxList bl(mf.boxArray().ixType());
+            Vector<int> cpmap;
+            for(int i : changed) {
+                bl.push_back(mf.boxArray()[i]);
+                cpmap.push_back(pmap[i]);
+            }
+            FabArray<FArrayBox> cmf(BoxArray(std::move(bl)), DistributionMapping(std::move(cpmap)),
+                                    mf.nComp(), mf.nGrowVect(), MFInfo().SetArena(mf.arena()));
+            for(MFIter mfi(cmf); mfi.isValid(); ++mfi) {
+                auto const& dst = cmf.array(mfi);
+                auto const& src = mf.const_array(changed[mfi.index()]);
+                amrex::ParallelFor(mfi.fabbox(), mf.nComp(),
+                [=] AMREX_GPU_DEVICE (int i, int j, int k, int n) noexcept
+                {
+                    dst(i,j,k,n) = src(i,j,k,n);
+                });
+            }
+            Gpu::streamSynchronize();
+            bytesWritten += VisMF::Write(cmf, mf_name, how);
+            ParallelDescriptor::Barrier("VisMF::WriteDelta");
+            if(ParallelDescriptor::MyProc() == ioProc) {
+                std::ifstream ifs(mf_name + TheMultiFabHdrFileSuffix);
+                if( ! ifs.good()) {
+                    amrex::FileOpenFailed(mf_name + TheMultiFabHdrFileSuffix);
+                }
+                ifs >> changedHdr;
+            }
+        }
+
+        // ---- the header of mf refers to both sets of files
+        VisMF::Header hdr(mf, how, currentVersion, false);
+        if(currentVersion == VisMF::Header::Version_v1 ||
+           currentVersion == VisMF::Header::NoFabHeaderMinMax_v1)
+        {
+            hdr.CalculateMinMax(mf, ioProc);
+        }
+        if(ParallelDescriptor::MyProc() == ioProc) {
+            const std::string dir(VisMF::DirName(mf_name));
+            const std::string refDir(VisMF::DirName(ref_name));
+            int j(0);
+            for(int i(0); i < nfabs; ++i) {
+                if(j < changed.size() && changed[j] == i) {
+                    hdr.m_fod[i] = changedHdr.m_fod[j];
+                    if(isCompressed(currentVersion)) {
+                        hdr.m_comp_bytes[i] = changedHdr.m_comp_bytes[j];
+                    }
+                    ++j;
+                } else {
+                    hdr.m_fod[i].m_name = relativePath(refDir + refHdr.m_fod[i].m_name, dir);
+                    hdr.m_fod[i].m_head = refHdr.m_fod[i].m_head;
+                    if(isCompressed(currentVersion)) {
+                        hdr.m_comp_bytes[i] = refHdr.m_comp_bytes[i];
+                    }
+                }
+            }
+            hdr.m_error_bound = std::max(changedHdr.m_error_bound, refHdr.m_error_bound);
+        }
+        bytesWritten += VisMF::WriteHeader(mf_name, hdr, ioProc);
+    }
+
+    if(ParallelDescriptor::MyProc() == ioProc) {
+        std::ofstream ofs(mf_name + TheFabHashFileSuffix);
+        if( ! ofs.good()) {
+            amrex::FileOpenFailed(mf_name + TheFabHashFileSuffix);
+        }
+        ofs << hashes.size() << '\n' << std::hex;
+        for(int i(0); i < nfabs; ++i) {
+            ofs << hashes[2 * i] << ' ' << hashes[2 * i + 1] << '\n';
+        }
+        bytesWritten += VisMF::FileOffset(ofs);
+    }
+
+    if(verbose && ParallelDescriptor::IOProcessor()) {
+        amrex::Print() << "VisMF::WriteDelta:  " << mf_name << ":  wrote " << changed.size()
+                       << " of " << nfabs << " fabs\n";
+    }
+
+    return bytesWritten;
+}
+
 Long
 VisMF::WriteOnlyHeader (const FabArray<FArrayBox> & mf,
                         const std::string         & mf_name,
@@ -1253,6 +1825,43 @@ VisMF::FindOffsets (const FabArray<FArrayBox> &mf,
       int whichRDBytes(whichRD->numBytes());
       int nComps(mf.nComp());
 
+#ifdef BL_USE_MPI
+      if(isCompressed(hdr.m_vers) && nProcs > 1) {
+        // ---- the compressed sizes are only known on the writing ranks
+        const Vector<int> &pmap = mf.DistributionMap().ProcessorMap();
+        // ---- nitems per rank = nfabs * nblocks
+        const int nblocks = (hdr.m_vers == VisMF::Header::Compressed_v2) ? nComps : 1;
+        Vector<int> nitems(nProcs, 0), disp(nProcs, 0);
+        for(int i(0), N(mf.size()); i < N; ++i) {
+          nitems[pmap[i]] += nblocks;
+        }
+        for(int i(1); i < nProcs; ++i) {
+          disp[i] = disp[i-1] + nitems[i-1];
+        }
+        Vector<Long> senddata;
+        for(MFIter mfi(mf); mfi.isValid(); ++mfi) {
+          auto const& comp_bytes = hdr.m_comp_bytes[mfi.index()];
+          senddata.insert(senddata.end(), comp_bytes.begin(), comp_bytes.end());
+        }
+        senddata.resize(std::max(nitems[myProc], 1));
+        Vector<Long> recvdata(std::max(mf.size() * nblocks, 1));
+        BL_MPI_REQUIRE( MPI_Gatherv(senddata.dataPtr(), nitems[myProc],
+                                    ParallelDescriptor::Mpi_typemap<Long>::type(),
+                                    recvdata.dataPtr(), nitems.dataPtr(), disp.dataPtr(),
+                                    ParallelDescriptor::Mpi_typemap<Long>::type(),
+                                    coordinatorProc, comm) );
+        if(myProc == coordinatorProc) {
+          Vector<int> cnt(nProcs, 0);
+          for(int j(0), N(mf.size()); j < N; ++j) {
+            const int i(pmap[j]);
+            for(int n(0); n < nblocks; ++n) {
+              hdr.m_comp_bytes[j][n] = recvdata[disp[i] + cnt[i]++];
+            }
+          }
+        }
+      }
+#endif
+
       if(myProc == coordinatorProc) {   // ---- calculate offsets
         const BoxArray &mfBA = mf.boxArray();
         const DistributionMapping &mfDM = mf.DistributionMap();
@@ -1309,8 +1918,12 @@ VisMF::FindOffsets (const FabArray<FArrayBox> &mf,
               for(int i(0); i < index.size(); ++i) {
                  hdr.m_fod[index[i]].m_name = whichFileName;
                  hdr.m_fod[index[i]].m_head = currentOffset[whichFileNumber];
-                 currentOffset[whichFileNumber] += mf.fabbox(index[i]).numPts() * nComps * whichRDBytes
-                                                   + fabHeaderBytes[index[i]];
+                 if(isCompressed(hdr.m_vers)) {
+                   currentOffset[whichFileNumber] += compressedFabBytes(hdr, index[i]);
+                 } else {
+                   currentOffset[whichFileNumber] += mf.fabbox(index[i]).numPts() * nComps * whichRDBytes
+                                                     + fabHeaderBytes[index[i]];
+                 }
               }
             }
           }
@@ -1414,7 +2027,13 @@ VisMF::readFAB (int                  idx,
           fabdata = hostfab->dataPtr();
       }
 #endif
-      if(whichComp == -1) {    // ---- read all components
+      if(isCompressed(hdr.m_vers)) {
+        if(whichComp == -1) {
+          readCompressedFAB(*infs, hdr, idx, 0, hdr.m_ncomp, fabdata, fab->box().numPts());
+        } else {
+          readCompressedFAB(*infs, hdr, idx, whichComp, 1, fabdata, fab->box().numPts());
+        }
+      } else if(whichComp == -1) {    // ---- read all components
         if(hdr.m_writtenRD == FPC::NativeRealDescriptor()) {
           infs->read((char *) fabdata, static_cast<std::streamsize>(fab->nBytes()));
         } else {
@@ -1472,7 +2091,9 @@ VisMF::readFAB (FabArray<FArrayBox> &mf,
           fabdata = hostfab->dataPtr();
       }
 #endif
-      if(hdr.m_writtenRD == FPC::NativeRealDescriptor()) {
+      if(isCompressed(hdr.m_vers)) {
+        readCompressedFAB(*infs, hdr, idx, 0, hdr.m_ncomp, fabdata, fab.box().numPts());
+      } else if(hdr.m_writtenRD == FPC::NativeRealDescriptor()) {
         infs->read((char *) fabdata, static_cast<std::streamsize>(fab.nBytes()));
       } else {
         Long readDataItems(fab.box().numPts() * fab.nComp());
@@ -1558,10 +2179,10 @@ VisMF::Read (FabArray<FArrayBox> &mf,
   int nProcs(ParallelDescriptor::NProcs());
   bool noFabHeader(NoFabHeader(hdr));
 
-  if(noFabHeader && useSynchronousReads) {
+  if(useSynchronousReads) {
 
     // ---- This code is only for reading in file order
-    bool doConvert(hdr.m_writtenRD != FPC::NativeRealDescriptor());
+    bool doConvert(noFabHeader && hdr.m_writtenRD != FPC::NativeRealDescriptor());
 
     // ---- Create an ordered map of which processors read which
     // ---- Fabs in each file
@@ -1573,49 +2194,65 @@ VisMF::Read (FabArray<FArrayBox> &mf,
     for(int i(0); i < nBoxes; ++i) {   // ---- create the map
       int undefined(-1);
       std::string fname(hdr.m_fod[i].m_name);
-      FileReadChains[fname].push_back(FabReadLink(undefined, undefined, hdr.m_fod[i].m_head, hdr.m_ba[i]));
+      // ---- faIndex holds the index in hdr until the chain is sorted
+      FileReadChains[fname].push_back(FabReadLink(undefined, i, hdr.m_fod[i].m_head, hdr.m_ba[i]));
     }
 
     std::map<std::string, Vector<FabReadLink> >::iterator frcIter;
 
+    // ---- the bytes of each fab on disk, in file order
+    Vector<Long> fileOrderBytes;
+    Long totalBytes(0);
+    for(frcIter = FileReadChains.begin(); frcIter != FileReadChains.end(); ++frcIter) {
+      Vector<FabReadLink> &frc = frcIter->second;
+      // ---- sort by offset
+      std::sort(frc.begin(), frc.end(), [] (const FabReadLink &a, const FabReadLink &b)
+                                              { return a.fileOffset < b.fileOffset; } );
+      for(const auto &frl : frc) {
+        Long nbytes;
+        if(isCompressed(hdr.m_vers)) {
+          nbytes = compressedFabBytes(hdr, frl.faIndex);
+        } else if( ! noFabHeader) {    // ---- m_writtenRD is in each fab header
+          nbytes = amrex::grow(frl.box, hdr.m_ngrow).numPts() * hdr.m_ncomp * Long(sizeof(Real));
+        } else {
+          nbytes = amrex::grow(frl.box, hdr.m_ngrow).numPts() * hdr.m_ncomp * hdr.m_writtenRD.numBytes();
+        }
+        fileOrderBytes.push_back(nbytes);
+        totalBytes += nbytes;
+      }
+    }
+
     int indexFileOrder(0);
-    int currentRank(0);
     FabArray<FArrayBox> fafabFileOrder;
     BoxArray baFileOrder(hdr.m_ba.size());
+    Vector<int> hdrIndexFileOrder(hdr.m_ba.size(), -1);
 
     Vector<int> ranksFileOrder(mf.DistributionMap().size(), -1);
 
-    Vector<int> nRanksPerFile(FileReadChains.size());
-    NItemsPerBin(nProcs, nRanksPerFile);
-    int currentFileIndex(0);
+    // ---- Split the fabs in file order into nProcs contiguous pieces
+    // ---- with about the same number of bytes, so each rank reads
+    // ---- one contiguous extent from as few files as possible.
+    Long bytesBefore(0);
 
     for(frcIter = FileReadChains.begin(); frcIter != FileReadChains.end(); ++frcIter) {
       const std::string &fileName = frcIter->first;
       Vector<FabReadLink> &frc = frcIter->second;
-      // ---- sort by offset
-      std::sort(frc.begin(), frc.end(), [] (const FabReadLink &a, const FabReadLink &b)
-                                              { return a.fileOffset < b.fileOffset; } );
-
-      Vector<int> nBoxesPerRank(nRanksPerFile[currentFileIndex]);
-      NItemsPerBin(static_cast<int>(frc.size()), nBoxesPerRank);
-      int frcIndex(0);
 
-      for(int nbpr(0); nbpr < nBoxesPerRank.size(); ++nbpr) {
-        for(int nb(0); nb < nBoxesPerRank[nbpr]; ++nb) {
+      for(auto &frl : frc) {
+        const Long nbytes(fileOrderBytes[indexFileOrder]);
+        const double mid((bytesBefore + 0.5 * nbytes) / std::max(totalBytes, Long(1)));
+        const int rankToRead(std::min(static_cast<int>(mid * nProcs), nProcs - 1));
+        bytesBefore += nbytes;
 
-          baFileOrder.set(indexFileOrder, frc[frcIndex].box);
-          ranksFileOrder[indexFileOrder] = currentRank;
-          frc[frcIndex].rankToRead = currentRank;
-          frc[frcIndex].faIndex    = indexFileOrder;
-          readFileRanks[fileName].insert(currentRank);
+        baFileOrder.set(indexFileOrder, frl.box);
+        ranksFileOrder[indexFileOrder] = rankToRead;
+        hdrIndexFileOrder[indexFileOrder] = frl.faIndex;
+        frl.rankToRead = rankToRead;
+        frl.faIndex    = indexFileOrder;
+        readFileRanks[fileName].insert(rankToRead);
 
-          ++frcIndex;
-          ++indexFileOrder;
-        }
-        ++currentRank;
-        currentRank = std::min(currentRank, nProcs - 1);
+        ++indexFileOrder;
       }
-      ++currentFileIndex;
     }
 
     DistributionMapping dmFileOrder(std::move(ranksFileOrder));
@@ -1635,7 +2272,9 @@ VisMF::Read (FabArray<FArrayBox> &mf,
 
     FabArray<FArrayBox> &whichFA = inFileOrder ? mf : fafabFileOrder;
 
-    // ---- check that a rank only needs to read one file
+    // ---- orders the ranks reading each file
+    const int readTag(ParallelDescriptor::SeqNum());
+
     std::map<std::string, std::set<int> >::iterator rfrIter;
     std::set<int>::iterator setIter;
 
@@ -1672,7 +2311,9 @@ VisMF::Read (FabArray<FArrayBox> &mf,
           frcIter = FileReadChains.find(fileName);
           BL_ASSERT(frcIter != FileReadChains.end());
           Vector<FabReadLink> &frc = frcIter->second;
-          for(NFilesIter nfi(std::move(fullFileName), readRanks); nfi.ReadyToRead(); ++nfi) {
+          for(NFilesIter nfi(std::move(fullFileName), readRanks, VisMF::setBuf, readTag);
+              nfi.ReadyToRead(); ++nfi)
+          {
 
               // ---- confirm the data is contiguous in the stream
               Long firstOffset(-1);
@@ -1692,8 +2333,7 @@ VisMF::Read (FabArray<FArrayBox> &mf,
                   if(currentOffset != frc[i].fileOffset) {
                     dataIsContiguous = false;
                   } else {
-                    FArrayBox &fab = whichFA[frc[i].faIndex];
-                    Long fabBytesToRead(fab.box().numPts() * fab.nComp() * hdr.m_writtenRD.numBytes());
+                    Long fabBytesToRead(fileOrderBytes[frc[i].faIndex]);
                     currentOffset += fabBytesToRead;
                     bytesToRead   += fabBytesToRead;
                     ++nFABs;
@@ -1703,7 +2343,8 @@ VisMF::Read (FabArray<FArrayBox> &mf,
               AMREX_ASSERT(bytesToRead >= 0 && bytesToRead < std::numeric_limits<Long>::max());
               char *allFabData;
               bool canCombineFABs(false);
-              if(nFABs > 1 && dataIsContiguous && VisMF::useSingleRead) {
+              // ---- fabs with headers are read through the stream buffer
+              if(nFABs > 1 && dataIsContiguous && VisMF::useSingleRead && noFabHeader) {
                 allFabData = new(std::nothrow) char[bytesToRead];
                 if(allFabData == nullptr) {
                   canCombineFABs = false;
@@ -1732,7 +2373,10 @@ VisMF::Read (FabArray<FArrayBox> &mf,
 #endif
                     Long readDataItems(fab.box().numPts() * fab.nComp());
                     AMREX_ASSERT(readDataItems >= 0 && readDataItems < std::numeric_limits<Long>::max());
-                    if(doConvert) {
+                    if(isCompressed(hdr.m_vers)) {
+                      decompressFAB(afPtr, hdr, hdrIndexFileOrder[frc[i].faIndex],
+                                    0, hdr.m_ncomp, fabdata, fab.box().numPts());
+                    } else if(doConvert) {
                       RealDescriptor::convertToNativeFormat(fabdata, readDataItems,
                                                             afPtr, hdr.m_writtenRD);
                     } else {
@@ -1740,7 +2384,7 @@ VisMF::Read (FabArray<FArrayBox> &mf,
                       AMREX_ASSERT(bytesToRead > currentOffset && nbytes <= std::size_t(bytesToRead - currentOffset));
                       std::memcpy(fabdata, afPtr, nbytes);
                     }
-                    currentOffset += readDataItems * hdr.m_writtenRD.numBytes();
+                    currentOffset += fileOrderBytes[frc[i].faIndex];
 #ifdef AMREX_USE_GPU
                     if (hostfab) {
                         Gpu::htod_memcpy_async(fab.dataPtr(), hostfab->dataPtr(),
@@ -1759,6 +2403,11 @@ VisMF::Read (FabArray<FArrayBox> &mf,
                       nfi.Stream().seekp(frc[i].fileOffset, std::ios::beg);
                     }
                     FArrayBox &fab = whichFA[frc[i].faIndex];
+                    if( ! noFabHeader) {
+                      // ---- readFrom stages device data through a pinned host fab
+                      fab.readFrom(nfi.Stream());
+                      continue;
+                    }
                     Real* fabdata = fab.dataPtr();
 #ifdef AMREX_USE_GPU
                     std::unique_ptr<FArrayBox> hostfab;
@@ -1768,7 +2417,10 @@ VisMF::Read (FabArray<FArrayBox> &mf,
                         fabdata = hostfab->dataPtr();
                     }
 #endif
-                    if(doConvert) {
+                    if(isCompressed(hdr.m_vers)) {
+                      readCompressedFAB(nfi.Stream(), hdr, hdrIndexFileOrder[frc[i].faIndex],
+                                        0, hdr.m_ncomp, fabdata, fab.box().numPts());
+                    } else if(doConvert) {
                       Long readDataItems(fab.box().numPts() * fab.nComp());
                       AMREX_ASSERT(readDataItems >= 0 && readDataItems < std::numeric_limits<Long>::max());
                       RealDescriptor::convertToNativeFormat(fabdata, readDataItems,
@@ -1801,7 +2453,7 @@ VisMF::Read (FabArray<FArrayBox> &mf,
       faCopyTime = amrex::second() - faCopyTime;
     }
 
-  } else {    // ---- (noFabHeader && useSynchronousReads) == false
+  } else {    // ---- useSynchronousReads == false
 
     int nReqs(0), ioProcNum(coordinatorProc);
     int nBoxes = static_cast<int>(hdr.m_ba.size());
@@ -2148,7 +2800,8 @@ VisMF::clear ()
 bool VisMF::NoFabHeader(const VisMF::Header &hdr) {
   if(hdr.m_vers == VisMF::Header::NoFabHeader_v1       ||
     hdr.m_vers == VisMF::Header::NoFabHeaderMinMax_v1 ||
-    hdr.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1)
+    hdr.m_vers == VisMF::Header::NoFabHeaderFAMinMax_v1 ||
+    isCompressed(hdr.m_vers))
   {
     return true;
   }
@@ -2355,137 +3008,213 @@ VisMF::AsyncWriteDoit (const FabArray<FArrayBox>& mf, const std::string& mf_name
     }
 #endif
 
-    auto myfabs = std::make_shared<Vector<FArrayBox> >();
-    for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
-        Box bx = strip_ghost ? mfi.validbox() : mfi.fabbox();
-#ifdef AMREX_USE_GPU
-        if (data_on_device) {
-            myfabs->emplace_back(bx, mf.nComp(), The_Pinned_Arena());
-            auto& new_fab = myfabs->back();
-            if (strip_ghost) {
-                new_fab.copy<RunOn::Device>(mf[mfi], bx);
-            } else {
-                Gpu::dtoh_memcpy_async(new_fab.dataPtr(), mf[mfi].dataPtr(), new_fab.size()*sizeof(Real));
-            }
-        } else
-#endif
-        {
-            if (is_rvalue && ! strip_ghost) {
-                myfabs->emplace_back(std::move(const_cast<FArrayBox&>(mf[mfi])));
-            } else {
-                myfabs->emplace_back(bx, mf.nComp(), The_Cpu_Arena());
-                auto& new_fab = myfabs->back();
-                new_fab.copy<RunOn::Host>(mf[mfi], bx);
-            }
+    // ---- With a staging limit, the data are copied out in chunks, and
+    // ---- copying waits for the writer if the limit would be exceeded.
+    // ---- Moved fabs are not copied, so they are not staged.
+    const Long max_staging = AsyncOut::MaxStagingBytes();
+    const bool staged = (max_staging > 0) && (data_on_device || ! is_rvalue || strip_ghost);
+    const Long chunk_limit = max_staging / 2;
+
+    // ---- Staged chunks are written at this rank's offset in the file.  A
+    // ---- job holding staged data must not wait for the other ranks in the
+    // ---- file to write all of theirs, or copying would stall until then.
+    int64_t my_offset = 0;
+#ifdef BL_USE_MPI
+    if (staged && nprocs > 1) {
+        Vector<int64_t> nbytes_all(nprocs);
+        ParallelAllGather::AllGather(total_bytes, nbytes_all.data(), ParallelDescriptor::Communicator());
+        auto info = AsyncOut::GetWriteInfo(myproc);
+        for (int ip = myproc - info.ispot; ip < myproc; ++ip) {
+            my_offset += nbytes_all[ip];
         }
     }
+#endif
 
     std::shared_ptr<FABio> fabio(new FABio_binary(FPC::NativeRealDescriptor().clone()));
 
-    AsyncOut::Submit([=] ()
+    // ---- The data are written by one or more jobs.  The first job writes
+    // ---- the header and waits for its turn to write, the last one notifies
+    // ---- the next rank in the file.  They share the output stream.  If
+    // ---- staged, the turn is only taken to open the file: the first rank
+    // ---- in the file creates it, and the others seek to their offsets.
+    auto ofs = std::make_shared<std::ofstream>();
+    auto io_buffer = std::make_shared<VisMF::IO_Buffer>(ioBufferSize);
+
+    auto write_job = [=] (std::shared_ptr<Vector<FArrayBox> > const& myfabs,
+                          bool first, bool last, Long staged_bytes)
     {
-        if (myproc == io_proc)
+        return [=] ()
         {
-            hdr->m_fod.resize(n_global_fabs);
-            hdr->m_min.resize(n_global_fabs);
-            hdr->m_max.resize(n_global_fabs);
-            hdr->m_famin.clear();
-            hdr->m_famax.clear();
-            hdr->m_famin.resize(ncomp,std::numeric_limits<Real>::max());
-            hdr->m_famax.resize(ncomp,std::numeric_limits<Real>::lowest());
-
-            Vector<int64_t> nbytes_on_rank(nprocs,-1L);
-            Vector<Vector<int> > gidx(nprocs);
-            for (int k = 0; k < n_global_fabs; ++k) {
-                int rank = dm[k];
-                gidx[rank].push_back(k);
-            }
-
-            auto* pgd = (char*)(globaldata->data());
+            if (first)
             {
-                int rank = 0, lidx = 0;
-                for (int j = 0; j < n_global_fabs; ++j)
+                if (myproc == io_proc)
                 {
-                    int k = -1;
-                    do {
-                        if (lidx < gidx[rank].size()) {
-                            k = gidx[rank][lidx];
-                            ++lidx;
-                        } else {
-                            ++rank;
-                            lidx = 0;
-                        }
-                    } while (k < 0);
+                    hdr->m_fod.resize(n_global_fabs);
+                    hdr->m_min.resize(n_global_fabs);
+                    hdr->m_max.resize(n_global_fabs);
+                    hdr->m_famin.clear();
+                    hdr->m_famax.clear();
+                    hdr->m_famin.resize(ncomp,std::numeric_limits<Real>::max());
+                    hdr->m_famax.resize(ncomp,std::numeric_limits<Real>::lowest());
+
+                    Vector<int64_t> nbytes_on_rank(nprocs,-1L);
+                    Vector<Vector<int> > gidx(nprocs);
+                    for (int k = 0; k < n_global_fabs; ++k) {
+                        int rank = dm[k];
+                        gidx[rank].push_back(k);
+                    }
 
-                    hdr->m_min[k].resize(ncomp);
-                    hdr->m_max[k].resize(ncomp);
+                    auto* pgd = (char*)(globaldata->data());
+                    {
+                        int rank = 0, lidx = 0;
+                        for (int j = 0; j < n_global_fabs; ++j)
+                        {
+                            int k = -1;
+                            do {
+                                if (lidx < gidx[rank].size()) {
+                                    k = gidx[rank][lidx];
+                                    ++lidx;
+                                } else {
+                                    ++rank;
+                                    lidx = 0;
+                                }
+                            } while (k < 0);
+
+                            hdr->m_min[k].resize(ncomp);
+                            hdr->m_max[k].resize(ncomp);
+
+                            if (nbytes_on_rank[rank] < 0) { // First time for this rank
+                                std::memcpy(&(nbytes_on_rank[rank]), pgd, sizeof(int64_t));
+                                pgd += sizeof(int64_t);
+                            }
+
+                            int64_t nbytes;
+                            std::memcpy(&nbytes, pgd, sizeof(int64_t));
+                            pgd += sizeof(int64_t);
+
+                            for (int icomp = 0; icomp < ncomp; ++icomp) {
+                                Real cmin, cmax;
+                                std::memcpy(&cmin, pgd             , sizeof(Real));
+                                std::memcpy(&cmax, pgd+sizeof(Real), sizeof(Real));
+                                pgd += sizeof(Real)*2;
+                                hdr->m_min[k][icomp] = cmin;
+                                hdr->m_max[k][icomp] = cmax;
+                                hdr->m_famin[icomp] = std::min(hdr->m_famin[icomp],cmin);
+                                hdr->m_famax[icomp] = std::max(hdr->m_famax[icomp],cmax);
+                            }
+
+                            auto info = AsyncOut::GetWriteInfo(rank);
+                            hdr->m_fod[k].m_name = amrex::Concatenate(VisMF::BaseName(mf_name)+FabFileSuffix,
+                                                                      info.ifile, 5);
+                            hdr->m_fod[k].m_head = nbytes;
+                        }
+                    }
 
-                    if (nbytes_on_rank[rank] < 0) { // First time for this rank
-                        std::memcpy(&(nbytes_on_rank[rank]), pgd, sizeof(int64_t));
-                        pgd += sizeof(int64_t);
+                    Vector<int64_t> offset(nprocs);
+                    for (int ip = 0; ip < nprocs; ++ip) {
+                        auto info = AsyncOut::GetWriteInfo(ip);
+                        if (info.ispot == 0) {
+                            offset[ip] = 0;
+                        } else {
+                            offset[ip] = offset[ip-1] + nbytes_on_rank[ip-1];
+                        }
                     }
 
-                    int64_t nbytes;
-                    std::memcpy(&nbytes, pgd, sizeof(int64_t));
-                    pgd += sizeof(int64_t);
-
-                    for (int icomp = 0; icomp < ncomp; ++icomp) {
-                        Real cmin, cmax;
-                        std::memcpy(&cmin, pgd             , sizeof(Real));
-                        std::memcpy(&cmax, pgd+sizeof(Real), sizeof(Real));
-                        pgd += sizeof(Real)*2;
-                        hdr->m_min[k][icomp] = cmin;
-                        hdr->m_max[k][icomp] = cmax;
-                        hdr->m_famin[icomp] = std::min(hdr->m_famin[icomp],cmin);
-                        hdr->m_famax[icomp] = std::max(hdr->m_famax[icomp],cmax);
+                    for (int k = 0; k < n_global_fabs; ++k) {
+                        hdr->m_fod[k].m_head += offset[dm[k]];
                     }
 
-                    auto info = AsyncOut::GetWriteInfo(rank);
-                    hdr->m_fod[k].m_name = amrex::Concatenate(VisMF::BaseName(mf_name)+FabFileSuffix,
-                                                              info.ifile, 5);
-                    hdr->m_fod[k].m_head = nbytes;
+                    VisMF::WriteHeaderDoit(mf_name, *hdr);
                 }
-            }
 
-            Vector<int64_t> offset(nprocs);
-            for (int ip = 0; ip < nprocs; ++ip) {
-                auto info = AsyncOut::GetWriteInfo(ip);
-                if (info.ispot == 0) {
-                    offset[ip] = 0;
-                } else {
-                    offset[ip] = offset[ip-1] + nbytes_on_rank[ip-1];
+                AsyncOut::Wait();  // Wait for my turn
+
+                if (staged) {
+                    auto info = AsyncOut::GetWriteInfo(myproc);
+                    std::string file_name = amrex::Concatenate(mf_name + FabFileSuffix, info.ifile, 5);
+                    ofs->rdbuf()->pubsetbuf(io_buffer->dataPtr(), io_buffer->size());
+                    ofs->open(file_name.c_str(), (info.ispot == 0) ? (std::ios::binary | std::ios::trunc)
+                                                                   : (std::ios::binary | std::ios::in | std::ios::out));
+                    if (!ofs->good()) amrex::FileOpenFailed(file_name);
+                    ofs->seekp(my_offset, std::ios::beg);
+                    AsyncOut::Notify();  // The file exists; the others can open it
                 }
             }
 
-            for (int k = 0; k < n_global_fabs; ++k) {
-                hdr->m_fod[k].m_head += offset[dm[k]];
+            double t0 = amrex::second();
+            auto info = AsyncOut::GetWriteInfo(myproc);
+            if (! myfabs->empty()) {
+                if (! ofs->is_open()) {
+                    std::string file_name = amrex::Concatenate(mf_name + FabFileSuffix, info.ifile, 5);
+                    ofs->rdbuf()->pubsetbuf(io_buffer->dataPtr(), io_buffer->size());
+                    ofs->open(file_name.c_str(), (info.ispot == 0) ? (std::ios::binary | std::ios::trunc)
+                                                                   : (std::ios::binary | std::ios::app));
+                    if (!ofs->good()) amrex::FileOpenFailed(file_name);
+                }
+                for (auto const& fab : *myfabs) {
+                    fabio->write_header(*ofs, fab, fab.nComp());
+                    fabio->write(*ofs, fab, 0, fab.nComp());
+                }
+                myfabs->clear();
             }
 
-            VisMF::WriteHeaderDoit(mf_name, *hdr);
-        }
-
-        VisMF::IO_Buffer io_buffer(ioBufferSize);
+            if (staged_bytes > 0) {
+                AsyncOut::ReleaseStaging(staged_bytes, amrex::second() - t0);
+            }
 
-        AsyncOut::Wait();  // Wait for my turn
+            if (last)
+            {
+                if (ofs->is_open()) {
+                    ofs->flush();
+                    ofs->close();
+                }
+                if (! staged) {
+                    AsyncOut::Notify();  // Notify others I am done
+                }
+            }
+        };
+    };
 
-        auto info = AsyncOut::GetWriteInfo(myproc);
-        if (! myfabs->empty()) {
-            std::string file_name = amrex::Concatenate(mf_name + FabFileSuffix, info.ifile, 5);
-            std::ofstream ofs;
-            ofs.rdbuf()->pubsetbuf(io_buffer.dataPtr(), io_buffer.size());
-            ofs.open(file_name.c_str(), (info.ispot == 0) ? (std::ios::binary | std::ios::trunc)
-                                                          : (std::ios::binary | std::ios::app));
-            if (!ofs.good()) amrex::FileOpenFailed(file_name);
-            for (auto const& fab : *myfabs) {
-                fabio->write_header(ofs, fab, fab.nComp());
-                fabio->write(ofs, fab, 0, fab.nComp());
+    auto myfabs = std::make_shared<Vector<FArrayBox> >();
+    Long chunk_bytes = 0;
+    bool first = true;
+    for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        Box bx = strip_ghost ? mfi.validbox() : mfi.fabbox();
+        if (staged) {
+            const Long nbytes = bx.numPts() * mf.nComp() * Long(sizeof(Real));
+            if (! myfabs->empty() && chunk_bytes + nbytes > chunk_limit) {
+                Gpu::streamSynchronize();
+                AsyncOut::Submit(write_job(myfabs, first, false, chunk_bytes));
+                myfabs = std::make_shared<Vector<FArrayBox> >();
+                chunk_bytes = 0;
+                first = false;
             }
-            ofs.flush();
-            ofs.close();
+            AsyncOut::AcquireStaging(nbytes);
+            chunk_bytes += nbytes;
         }
-
-        AsyncOut::Notify();  // Notify others I am done
-    });
+#ifdef AMREX_USE_GPU
+        if (data_on_device) {
+            myfabs->emplace_back(bx, mf.nComp(), The_Pinned_Arena());
+            auto& new_fab = myfabs->back();
+            if (strip_ghost) {
+                new_fab.copy<RunOn::Device>(mf[mfi], bx);
+            } else {
+                Gpu::dtoh_memcpy_async(new_fab.dataPtr(), mf[mfi].dataPtr(), new_fab.size()*sizeof(Real));
+            }
+        } else
+#endif
+        {
+            if (is_rvalue && ! strip_ghost) {
+                myfabs->emplace_back(std::move(const_cast<FArrayBox&>(mf[mfi])));
+            } else {
+                myfabs->emplace_back(bx, mf.nComp(), The_Cpu_Arena());
+                auto& new_fab = myfabs->back();
+                new_fab.copy<RunOn::Host>(mf[mfi], bx);
+            }
+        }
+    }
+    Gpu::streamSynchronize();
+    AsyncOut::Submit(write_job(myfabs, first, true, chunk_bytes));
 }
 
 }
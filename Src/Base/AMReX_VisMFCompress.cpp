@@ -0,0 +1,280 @@
+#include <AMReX_VisMFCompress.H>
+#include <AMReX.H>
+#include <AMReX_FPC.H>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace amrex::VisMFCompress {
+
+namespace {
+
+// Block modes
+constexpr char mode_stored    = 0; // rd formatted data as is
+constexpr char mode_lossless  = 1; // shuffle + LZ of rd formatted data
+constexpr char mode_quantized = 2; // shuffle + LZ of zigzag deltas of quantized native data
+
+// mode byte + uint64 decoded size (+ double step for mode_quantized)
+constexpr Long header_bytes = 1 + 8;
+
+constexpr int  hash_bits = 16;
+constexpr Long min_match = 4;
+
+void put_u64 (Vector<char>& dst, std::uint64_t v)
+{
+    for (int i = 0; i < 8; ++i) {
+        dst.push_back(static_cast<char>((v >> (8*i)) & 0xff));
+    }
+}
+
+std::uint64_t get_u64 (char const* p)
+{
+    std::uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) {
+        v |= std::uint64_t(static_cast<unsigned char>(p[i])) << (8*i);
+    }
+    return v;
+}
+
+void put_varint (Vector<char>& dst, std::uint64_t v)
+{
+    while (v >= 0x80) {
+        dst.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    dst.push_back(static_cast<char>(v));
+}
+
+std::uint64_t get_varint (unsigned char const*& p, unsigned char const* end)
+{
+    std::uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p >= end) { break; }
+        unsigned char c = *p++;
+        v |= std::uint64_t(c & 0x7f) << shift;
+        if ((c & 0x80) == 0) { return v; }
+    }
+    amrex::Abort("VisMFCompress: corrupt block");
+    return 0;
+}
+
+std::uint32_t read32 (unsigned char const* p)
+{
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+void shuffle (char const* src, Long nbytes, int elem_size, char* dst)
+{
+    Long const n = nbytes / elem_size;
+    for (Long j = 0; j < n; ++j) {
+        for (int k = 0; k < elem_size; ++k) {
+            dst[k*n+j] = src[j*elem_size+k];
+        }
+    }
+    std::memcpy(dst + n*elem_size, src + n*elem_size, nbytes - n*elem_size);
+}
+
+void unshuffle (char const* src, Long nbytes, int elem_size, char* dst)
+{
+    Long const n = nbytes / elem_size;
+    for (Long j = 0; j < n; ++j) {
+        for (int k = 0; k < elem_size; ++k) {
+            dst[j*elem_size+k] = src[k*n+j];
+        }
+    }
+    std::memcpy(dst + n*elem_size, src + n*elem_size, nbytes - n*elem_size);
+}
+
+void emit_literals (Vector<char>& dst, unsigned char const* p, Long n)
+{
+    if (n > 0) {
+        put_varint(dst, std::uint64_t(n) << 1);
+        dst.insert(dst.end(), p, p+n);
+    }
+}
+
+// Greedy LZ77.  The tokens are varint(nliterals << 1) followed by the
+// literals, or varint(((length-min_match) << 1) | 1) varint(distance).
+void lz_compress (unsigned char const* src, Long n, Vector<char>& dst)
+{
+    Vector<Long> table(Long(1) << hash_bits, -1);
+    Long i = 0;
+    Long lit = 0;
+    while (i + min_match <= n) {
+        std::uint32_t const v = read32(src+i);
+        std::uint32_t const h = (v * 2654435761U) >> (32-hash_bits);
+        Long const cand = table[h];
+        table[h] = i;
+        if (cand >= 0 && read32(src+cand) == v) {
+            Long len = min_match;
+            while (i+len < n && src[cand+len] == src[i+len]) { ++len; }
+            emit_literals(dst, src+lit, i-lit);
+            put_varint(dst, (std::uint64_t(len-min_match) << 1) | 1);
+            put_varint(dst, std::uint64_t(i-cand));
+            i += len;
+            lit = i;
+        } else {
+            ++i;
+        }
+    }
+    emit_literals(dst, src+lit, n-lit);
+}
+
+void lz_decompress (unsigned char const* src, Long nbytes, unsigned char* dst, Long n)
+{
+    unsigned char const* end = src + nbytes;
+    Long i = 0;
+    while (src < end) {
+        std::uint64_t const token = get_varint(src, end);
+        if (token & 1) {
+            Long const len = Long(token >> 1) + min_match;
+            Long const dist = Long(get_varint(src, end));
+            if (dist <= 0 || dist > i || len > n-i) {
+                amrex::Abort("VisMFCompress: corrupt block");
+            }
+            // The source and destination may overlap.
+            for (Long k = 0; k < len; ++k, ++i) {
+                dst[i] = dst[i-dist];
+            }
+        } else {
+            Long const len = Long(token >> 1);
+            if (len > n-i || len > end-src) {
+                amrex::Abort("VisMFCompress: corrupt block");
+            }
+            std::memcpy(dst+i, src, len);
+            src += len;
+            i += len;
+        }
+    }
+    if (i != n) {
+        amrex::Abort("VisMFCompress: corrupt block");
+    }
+}
+
+// Returns false if the data cannot be quantized within error_bound.
+bool quantize (Real const* data, Long n, Real error_bound, double& step, Vector<std::uint64_t>& q)
+{
+    // A slightly smaller step than 2*error_bound leaves room for rounding.
+    step = 2.0 * double(error_bound) * 0.999;
+    constexpr double qmax = double(std::int64_t(1) << 53);
+    q.resize(n);
+    std::int64_t prev = 0;
+    for (Long i = 0; i < n; ++i) {
+        double const v = data[i];
+        double const r = v / step;
+        if (!std::isfinite(r) || std::abs(r) >= qmax) { return false; }
+        auto const qi = static_cast<std::int64_t>(std::llround(r));
+        if (std::abs(Real(double(qi)*step) - data[i]) > error_bound) { return false; }
+        std::int64_t const d = qi - prev;
+        prev = qi;
+        q[i] = (std::uint64_t(d) << 1) ^ std::uint64_t(d >> 63); // zigzag
+    }
+    return true;
+}
+
+}
+
+void Compress (char const* src, Long nbytes, int elem_size, Vector<char>& dst)
+{
+    Vector<char> tmp(nbytes);
+    shuffle(src, nbytes, elem_size, tmp.data());
+    lz_compress(reinterpret_cast<unsigned char const*>(tmp.data()), nbytes, dst);
+}
+
+void Decompress (char const* src, Long nbytes, int elem_size, char* dst, Long dst_bytes)
+{
+    Vector<char> tmp(dst_bytes);
+    lz_decompress(reinterpret_cast<unsigned char const*>(src), nbytes,
+                  reinterpret_cast<unsigned char*>(tmp.data()), dst_bytes);
+    unshuffle(tmp.data(), dst_bytes, elem_size, dst);
+}
+
+void CompressFab (Real const* data, Long nitems, RealDescriptor const& rd,
+                  Real error_bound, Vector<char>& block)
+{
+    block.clear();
+
+    if (error_bound > 0 && rd == FPC::NativeRealDescriptor())
+    {
+        double step;
+        Vector<std::uint64_t> q;
+        if (quantize(data, nitems, error_bound, step, q))
+        {
+            Long const qbytes = nitems * Long(sizeof(std::uint64_t));
+            block.push_back(mode_quantized);
+            put_u64(block, std::uint64_t(qbytes));
+            std::uint64_t stepbits;
+            std::memcpy(&stepbits, &step, sizeof(double));
+            put_u64(block, stepbits);
+            Compress(reinterpret_cast<char const*>(q.data()), qbytes, sizeof(std::uint64_t), block);
+            return;
+        }
+    }
+
+    int const elem_size = rd.numBytes();
+    Long const nbytes = nitems * elem_size;
+    Vector<char> raw(nbytes);
+    RealDescriptor::convertFromNativeFormat(raw.data(), nitems, data, rd);
+
+    block.push_back(mode_lossless);
+    put_u64(block, std::uint64_t(nbytes));
+    Compress(raw.data(), nbytes, elem_size, block);
+
+    if (Long(block.size()) >= header_bytes + nbytes) {
+        block.clear();
+        block.push_back(mode_stored);
+        put_u64(block, std::uint64_t(nbytes));
+        block.insert(block.end(), raw.begin(), raw.end());
+    }
+}
+
+void DecompressFab (char const* block, Long nbytes, RealDescriptor const& rd,
+                    Real* data, Long nitems)
+{
+    if (nbytes < header_bytes) {
+        amrex::Abort("VisMFCompress: corrupt block");
+    }
+    char const mode = block[0];
+    Long const dbytes = Long(get_u64(block+1));
+
+    if (mode == mode_quantized)
+    {
+        if (dbytes != nitems * Long(sizeof(std::uint64_t)) || nbytes < header_bytes+8) {
+            amrex::Abort("VisMFCompress: corrupt block");
+        }
+        std::uint64_t const stepbits = get_u64(block+header_bytes);
+        double step;
+        std::memcpy(&step, &stepbits, sizeof(double));
+        Vector<std::uint64_t> q(nitems);
+        Decompress(block+header_bytes+8, nbytes-header_bytes-8, sizeof(std::uint64_t),
+                   reinterpret_cast<char*>(q.data()), dbytes);
+        std::int64_t qi = 0;
+        for (Long i = 0; i < nitems; ++i) {
+            auto const d = static_cast<std::int64_t>(q[i] >> 1) ^ -static_cast<std::int64_t>(q[i] & 1);
+            qi += d;
+            data[i] = static_cast<Real>(double(qi)*step);
+        }
+        return;
+    }
+
+    if (dbytes != nitems * Long(rd.numBytes())) {
+        amrex::Abort("VisMFCompress: corrupt block");
+    }
+    if (mode == mode_stored) {
+        if (nbytes - header_bytes != dbytes) {
+            amrex::Abort("VisMFCompress: corrupt block");
+        }
+        RealDescriptor::convertToNativeFormat(data, nitems, const_cast<char*>(block+header_bytes), rd);
+    } else if (mode == mode_lossless) {
+        Vector<char> raw(dbytes);
+        Decompress(block+header_bytes, nbytes-header_bytes, rd.numBytes(), raw.data(), dbytes);
+        RealDescriptor::convertToNativeFormat(data, nitems, raw.data(), rd);
+    } else {
+        amrex::Abort("VisMFCompress: unknown block mode");
+    }
+}
+
+}
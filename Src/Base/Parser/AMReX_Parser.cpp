@@ -6,6 +6,7 @@
 #include <amrex_parser.tab.h>
 
 #include <algorithm>
+#include <cstring>
 
 namespace amrex {
 
@@ -43,8 +44,10 @@ Parser::Data::~Data ()
     m_expression.clear();
     if (m_parser) { amrex_parser_delete(m_parser); }
     if (m_host_executor) { The_Pinned_Arena()->free(m_host_executor); }
+    if (m_host_lowered) { The_Pinned_Arena()->free(m_host_lowered); }
 #ifdef AMREX_USE_GPU
     if (m_device_executor) { The_Arena()->free(m_device_executor); }
+    if (m_device_lowered) { The_Arena()->free(m_device_lowered); }
 #endif
 }
 
@@ -129,4 +132,34 @@ Parser::printExe () const
     }
 }
 
+void
+Parser::printLowered () const
+{
+    if (m_data->m_host_lowered) {
+        parser_reg_print(m_data->m_host_lowered, m_vars);
+    }
+}
+
+bool
+Parser::lowerHost () const
+{
+    if (m_data->m_lowered_size == 0) {
+        Vector<char> prog;
+        try {
+            prog = parser_reg_compile(m_data->m_parser, m_data->m_nvars);
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(std::string(e.what()) + " in Parser expression \""
+                                     + m_data->m_expression + "\"");
+        }
+        if (prog.empty()) {
+            m_data->m_lowered_size = -1;
+        } else {
+            m_data->m_lowered_size = static_cast<int>(prog.size());
+            m_data->m_host_lowered = (char*)The_Pinned_Arena()->alloc(prog.size());
+            std::memcpy(m_data->m_host_lowered, prog.data(), prog.size());
+        }
+    }
+    return m_data->m_lowered_size > 0;
+}
+
 }
@@ -0,0 +1,551 @@
+#include <AMReX_Parser_Reg.H>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace amrex {
+
+namespace {
+
+    // A value in the SSA form of the program before register allocation.
+    // a, b and c are ids of other values, except for POWI whose b is the
+    // exponent.  Input variables have op == -1.  d is the register assigned
+    // to the value.  trap is true if computing the value, including its
+    // operands, may raise a floating point exception for some inputs.
+    struct RegValue {
+        int op = -1;
+        int f = 0;
+        int a = 0;
+        int b = 0;
+        int c = 0;
+        double v = 0.0;
+        int d = 0;
+        bool trap = false;
+    };
+
+    int reg_num_operands (int op)
+    {
+        switch (op)
+        {
+        case PARSER_REG_ADD:
+        case PARSER_REG_SUB:
+        case PARSER_REG_MUL:
+        case PARSER_REG_DIV:
+        case PARSER_REG_F2:
+            return 2;
+        case PARSER_REG_ADD_VR:
+        case PARSER_REG_SUB_VR:
+        case PARSER_REG_MUL_VR:
+        case PARSER_REG_DIV_VR:
+        case PARSER_REG_DIV_RV:
+        case PARSER_REG_NEG:
+        case PARSER_REG_F1:
+        case PARSER_REG_SQUARE:
+        case PARSER_REG_POWI:
+            return 1;
+        case PARSER_REG_IF:
+            return 3;
+        default:
+            return 0;
+        }
+    }
+
+    // Whether the operation itself may raise a floating point exception,
+    // e.g., 1/x or log(x) at x = 0.  Overflow of +, - and * is ignored.
+    bool reg_may_trap (int op, int f, int b, double v)
+    {
+        switch (op)
+        {
+        case PARSER_REG_DIV:
+        case PARSER_REG_DIV_VR:
+            return true;
+        case PARSER_REG_DIV_RV:
+            return v == 0.0;
+        case PARSER_REG_POWI:
+            return b < 0;
+        case PARSER_REG_F1:
+            switch (parser_f1_t(f))
+            {
+            case PARSER_SIN:
+            case PARSER_COS:
+            case PARSER_ATAN:
+            case PARSER_TANH:
+            case PARSER_ABS:
+            case PARSER_FLOOR:
+            case PARSER_CEIL:
+                return false;
+            default:
+                return true;
+            }
+        case PARSER_REG_F2:
+            switch (parser_f2_t(f))
+            {
+            case PARSER_POW:
+            case PARSER_JN:
+            case PARSER_FMOD:
+                return true;
+            default:
+                return false;
+            }
+        default:
+            return false;
+        }
+    }
+
+    class RegLowering
+    {
+    public:
+        explicit RegLowering (int nvars)
+        {
+            for (int i = 0; i < nvars; ++i) {
+                RegValue val;
+                val.a = i;
+                m_vals.push_back(val);
+            }
+        }
+
+        int lower (struct parser_node* node);
+
+        Vector<RegValue> const& values () const { return m_vals; }
+
+        //! Whether a branch of if(c,a,b) may trap.  Because the program
+        //! evaluates both branches, it cannot be used then.
+        [[nodiscard]] bool unsafe_if () const { return m_unsafe_if; }
+
+    private:
+
+        [[nodiscard]] bool is_number (int i) const {
+            return m_vals[i].op == PARSER_REG_NUMBER;
+        }
+
+        [[nodiscard]] double number_value (int i) const { return m_vals[i].v; }
+
+        int make (int op, int f, int a, int b, int c, double v);
+
+        int number (double v) { return make(PARSER_REG_NUMBER, 0, 0, 0, 0, v); }
+        int add (int a, int b);
+        int sub (int a, int b);
+        int mul (int a, int b);
+        int div (int a, int b);
+        int neg (int a);
+        int f1 (parser_f1_t f, int a);
+        int f2 (parser_f2_t f, int a, int b);
+        int square (int a);
+        int powi (int a, int n);
+
+        Vector<RegValue> m_vals;
+        std::map<std::tuple<int,int,int,int,int,std::uint64_t>,int> m_cse;
+        Vector<std::pair<char const*,int>> m_locals;
+        bool m_unsafe_if = false;
+    };
+
+    int
+    RegLowering::make (int op, int f, int a, int b, int c, double v)
+    {
+        std::uint64_t vbits;
+        std::memcpy(&vbits, &v, sizeof(double));
+        auto key = std::make_tuple(op, f, a, b, c, vbits);
+        auto it = m_cse.find(key);
+        if (it != m_cse.end()) {
+            return it->second;
+        } else {
+            int id = static_cast<int>(m_vals.size());
+            const int nops = reg_num_operands(op);
+            const bool trap = reg_may_trap(op, f, b, v)
+                || (nops > 0 && m_vals[a].trap)
+                || (nops > 1 && m_vals[b].trap)
+                || (nops > 2 && m_vals[c].trap);
+            m_vals.push_back(RegValue{op, f, a, b, c, v, 0, trap});
+            m_cse.emplace(key, id);
+            return id;
+        }
+    }
+
+    int
+    RegLowering::add (int a, int b)
+    {
+        if (is_number(a) && is_number(b)) {
+            return number(number_value(a) + number_value(b));
+        } else if (m_vals[b].op == PARSER_REG_NEG) { // a + (-b) => a - b
+            return sub(a, m_vals[b].a);
+        } else if (m_vals[a].op == PARSER_REG_NEG) { // (-a) + b => b - a
+            return sub(b, m_vals[a].a);
+        } else if (is_number(a)) {
+            return make(PARSER_REG_ADD_VR, 0, b, 0, 0, number_value(a));
+        } else if (is_number(b)) {
+            return make(PARSER_REG_ADD_VR, 0, a, 0, 0, number_value(b));
+        } else {
+            return make(PARSER_REG_ADD, 0, std::min(a,b), std::max(a,b), 0, 0.0);
+        }
+    }
+
+    int
+    RegLowering::sub (int a, int b)
+    {
+        if (is_number(a) && is_number(b)) {
+            return number(number_value(a) - number_value(b));
+        } else if (is_number(a)) {
+            return make(PARSER_REG_SUB_VR, 0, b, 0, 0, number_value(a));
+        } else if (is_number(b)) { // a - 3 => -3 + a
+            return make(PARSER_REG_ADD_VR, 0, a, 0, 0, -number_value(b));
+        } else {
+            return make(PARSER_REG_SUB, 0, a, b, 0, 0.0);
+        }
+    }
+
+    int
+    RegLowering::mul (int a, int b)
+    {
+        if (is_number(a) && is_number(b)) {
+            return number(number_value(a) * number_value(b));
+        } else if (is_number(a)) {
+            if (number_value(a) == -1.0) {
+                return neg(b);
+            } else {
+                return make(PARSER_REG_MUL_VR, 0, b, 0, 0, number_value(a));
+            }
+        } else if (is_number(b)) {
+            if (number_value(b) == -1.0) {
+                return neg(a);
+            } else {
+                return make(PARSER_REG_MUL_VR, 0, a, 0, 0, number_value(b));
+            }
+        } else {
+            return make(PARSER_REG_MUL, 0, std::min(a,b), std::max(a,b), 0, 0.0);
+        }
+    }
+
+    int
+    RegLowering::div (int a, int b)
+    {
+        if (is_number(a) && is_number(b)) {
+            return number(number_value(a) / number_value(b));
+        } else if (is_number(a)) {
+            return make(PARSER_REG_DIV_VR, 0, b, 0, 0, number_value(a));
+        } else if (is_number(b)) {
+            return make(PARSER_REG_DIV_RV, 0, a, 0, 0, number_value(b));
+        } else {
+            return make(PARSER_REG_DIV, 0, a, b, 0, 0.0);
+        }
+    }
+
+    int
+    RegLowering::neg (int a)
+    {
+        if (is_number(a)) {
+            return number(-number_value(a));
+        } else if (m_vals[a].op == PARSER_REG_NEG) {
+            return m_vals[a].a;
+        } else {
+            return make(PARSER_REG_NEG, 0, a, 0, 0, 0.0);
+        }
+    }
+
+    int
+    RegLowering::f1 (parser_f1_t f, int a)
+    {
+        if (is_number(a)) {
+            return number(parser_call_f1(f, number_value(a)));
+        } else {
+            return make(PARSER_REG_F1, f, a, 0, 0, 0.0);
+        }
+    }
+
+    int
+    RegLowering::f2 (parser_f2_t f, int a, int b)
+    {
+        if (is_number(a) && is_number(b)) {
+            return number(parser_call_f2(f, number_value(a), number_value(b)));
+        } else {
+            return make(PARSER_REG_F2, f, a, b, 0, 0.0);
+        }
+    }
+
+    int
+    RegLowering::square (int a)
+    {
+        if (is_number(a)) {
+            return number(number_value(a) * number_value(a));
+        } else {
+            return make(PARSER_REG_SQUARE, 0, a, 0, 0, 0.0);
+        }
+    }
+
+    int
+    RegLowering::powi (int a, int n)
+    {
+        if (is_number(a)) {
+            return number(parser_reg_powi(number_value(a), n));
+        } else {
+            return make(PARSER_REG_POWI, 0, a, n, 0, 0.0);
+        }
+    }
+
+    int
+    RegLowering::lower (struct parser_node* node)
+    {
+        switch (node->type)
+        {
+        case PARSER_NUMBER:
+            return number(parser_get_number(node));
+        case PARSER_SYMBOL:
+        {
+            auto* sym = (struct parser_symbol*)node;
+            auto r = std::find_if(m_locals.rbegin(), m_locals.rend(),
+                                  [=] (std::pair<char const*,int> const& l)
+                                      { return std::strcmp(sym->name, l.first) == 0; });
+            if (r != m_locals.rend()) {
+                return r->second;
+            } else if (sym->ip < 0) {
+                throw std::runtime_error(std::string("Unknown variable ") + sym->name);
+            } else {
+                return sym->ip;
+            }
+        }
+        case PARSER_ADD:
+        {
+            int a = lower(node->l);
+            int b = lower(node->r);
+            return add(a, b);
+        }
+        case PARSER_SUB:
+        {
+            int a = lower(node->l);
+            int b = lower(node->r);
+            return sub(a, b);
+        }
+        case PARSER_MUL:
+        {
+            int a = lower(node->l);
+            int b = lower(node->r);
+            return mul(a, b);
+        }
+        case PARSER_DIV:
+        {
+            int a = lower(node->l);
+            int b = lower(node->r);
+            return div(a, b);
+        }
+        case PARSER_F1:
+        {
+            auto* n = (struct parser_f1*)node;
+            return f1(n->ftype, lower(n->l));
+        }
+        case PARSER_F2:
+        {
+            // Integer powers must be handled the same way as in
+            // parser_compile_exe_size so that the results are identical.
+            auto* n = (struct parser_f2*)node;
+            if (n->ftype == PARSER_POW && n->r->type == PARSER_NUMBER) {
+                double e = parser_get_number(n->r);
+                if (e == 2.0) {
+                    return square(lower(n->l));
+                } else if (e == std::floor(e)) {
+                    return powi(lower(n->l), int(e));
+                }
+            }
+            int a = lower(n->l);
+            int b = lower(n->r);
+            return f2(n->ftype, a, b);
+        }
+        case PARSER_F3:
+        {
+            auto* n = (struct parser_f3*)node;
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(n->ftype == PARSER_IF,
+                                             "parser_reg_compile: unknown f3 type");
+            int c = lower(n->n1);
+            if (is_number(c)) {
+                return (number_value(c) != 0.0) ? lower(n->n2) : lower(n->n3);
+            }
+            int a = lower(n->n2);
+            int b = lower(n->n3);
+            if (a == b) {
+                return a;
+            } else {
+                if (m_vals[a].trap || m_vals[b].trap) {
+                    m_unsafe_if = true;
+                }
+                return make(PARSER_REG_IF, 0, c, a, b, 0.0);
+            }
+        }
+        case PARSER_ASSIGN:
+        {
+            auto* asgn = (struct parser_assign*)node;
+            int v = lower(asgn->v);
+            m_locals.emplace_back(asgn->s->name, v);
+            return v;
+        }
+        case PARSER_LIST:
+        {
+            lower(node->l);
+            return lower(node->r);
+        }
+        default:
+            amrex::Abort("parser_reg_compile: unknown node type " + std::to_string(node->type));
+            return 0;
+        }
+    }
+}
+
+Vector<char>
+parser_reg_compile (struct amrex_parser* parser, int nvars)
+{
+    RegLowering lowering(nvars);
+    const int result = lowering.lower(parser->ast);
+    if (lowering.unsafe_if()) {
+        return Vector<char>{};
+    }
+    auto const& vals = lowering.values();
+    const int nvals = static_cast<int>(vals.size());
+
+    auto operands = [&] (RegValue const& val) -> Vector<int>
+    {
+        Vector<int> r;
+        int n = reg_num_operands(val.op);
+        if (n > 0) { r.push_back(val.a); }
+        if (n > 1) { r.push_back(val.b); }
+        if (n > 2) { r.push_back(val.c); }
+        return r;
+    };
+
+    // Dead code elimination.  Values only depend on values with smaller ids.
+    Vector<char> live(nvals, 0);
+    live[result] = 1;
+    for (int i = nvals-1; i >= nvars; --i) {
+        if (live[i]) {
+            for (int o : operands(vals[i])) { live[o] = 1; }
+        }
+    }
+
+    constexpr int infinity = std::numeric_limits<int>::max();
+    Vector<int> last_use(nvals, -1);
+    for (int i = nvars; i < nvals; ++i) {
+        if (live[i]) {
+            for (int o : operands(vals[i])) { last_use[o] = i; }
+        }
+    }
+    last_use[result] = infinity;
+
+    // Linear scan register allocation.  Registers [0,nvars) are reserved for
+    // the input variables.
+    Vector<int> reg(nvals, -1);
+    for (int i = 0; i < nvars; ++i) { reg[i] = i; }
+    int nregs = nvars;
+    std::set<int> free_regs;
+    Vector<RegValue> insts;
+    for (int i = nvars; i < nvals; ++i) {
+        if (!live[i]) { continue; }
+        auto const& val = vals[i];
+        auto ops = operands(val);
+        for (int o : ops) {
+            if (o >= nvars && last_use[o] == i) {
+                free_regs.insert(reg[o]);
+            }
+        }
+        if (free_regs.empty()) {
+            reg[i] = nregs++;
+        } else {
+            reg[i] = *free_regs.begin();
+            free_regs.erase(free_regs.begin());
+        }
+
+        insts.push_back(val);
+        insts.back().d = reg[i];
+        for (int& o : ops) { o = reg[o]; }
+        if (ops.size() > 0) { insts.back().a = ops[0]; }
+        if (ops.size() > 1) { insts.back().b = ops[1]; }
+        if (ops.size() > 2) { insts.back().c = ops[2]; }
+    }
+
+    if (nregs > AMREX_PARSER_REG_SIZE) {
+        return Vector<char>{};
+    }
+
+    ParserRegHeader hdr{};
+    hdr.ninst = static_cast<int>(insts.size());
+    hdr.nregs = nregs;
+    hdr.nvars = nvars;
+    hdr.result = reg[result];
+
+    Vector<char> r;
+    r.reserve(sizeof(ParserRegHeader) + insts.size()*sizeof(ParserRegInst));
+    auto const* ph = reinterpret_cast<char const*>(&hdr);
+    r.insert(r.end(), ph, ph + sizeof(ParserRegHeader));
+    for (auto const& val : insts) {
+        ParserRegInst t{};
+        t.op = static_cast<unsigned char>(val.op);
+        t.f = static_cast<unsigned char>(val.f);
+        t.d = static_cast<unsigned char>(val.d);
+        t.a = static_cast<unsigned char>(val.a);
+        t.b = static_cast<unsigned char>(val.b);
+        t.c = static_cast<unsigned char>(val.c);
+        t.v = (val.op == PARSER_REG_POWI) ? double(val.b) : val.v;
+        auto const* pt = reinterpret_cast<char const*>(&t);
+        r.insert(r.end(), pt, pt + sizeof(ParserRegInst));
+    }
+    return r;
+}
+
+void
+parser_reg_print (char const* p, Vector<std::string> const& vars)
+{
+    ParserRegHeader hdr;
+    std::memcpy(&hdr, p, sizeof(ParserRegHeader));
+    auto& os = amrex::OutStream();
+    os << "  # registers: " << hdr.nregs << "\n";
+
+    auto rname = [&] (int i) -> std::string
+    {
+        if (i < hdr.nvars && i < static_cast<int>(vars.size())) {
+            return vars[i];
+        } else {
+            return "r" + std::to_string(i);
+        }
+    };
+
+    for (int n = 0; n < hdr.ninst; ++n) {
+        ParserRegInst t;
+        std::memcpy(&t, p + sizeof(ParserRegHeader) + n*sizeof(ParserRegInst),
+                    sizeof(ParserRegInst));
+        os << std::setw(3) << n << "   r" << t.d << " = ";
+        switch (t.op)
+        {
+        case PARSER_REG_NUMBER: os << t.v; break;
+        case PARSER_REG_ADD:    os << rname(t.a) << " + " << rname(t.b); break;
+        case PARSER_REG_SUB:    os << rname(t.a) << " - " << rname(t.b); break;
+        case PARSER_REG_MUL:    os << rname(t.a) << " * " << rname(t.b); break;
+        case PARSER_REG_DIV:    os << rname(t.a) << " / " << rname(t.b); break;
+        case PARSER_REG_ADD_VR: os << t.v << " + " << rname(t.a); break;
+        case PARSER_REG_SUB_VR: os << t.v << " - " << rname(t.a); break;
+        case PARSER_REG_MUL_VR: os << t.v << " * " << rname(t.a); break;
+        case PARSER_REG_DIV_VR: os << t.v << " / " << rname(t.a); break;
+        case PARSER_REG_DIV_RV: os << rname(t.a) << " / " << t.v; break;
+        case PARSER_REG_NEG:    os << "-" << rname(t.a); break;
+        case PARSER_REG_F1:
+            os << parser_f1_s[t.f] << "(" << rname(t.a) << ")";
+            break;
+        case PARSER_REG_F2:
+            os << parser_f2_s[t.f] << "(" << rname(t.a) << ", " << rname(t.b) << ")";
+            break;
+        case PARSER_REG_SQUARE: os << rname(t.a) << "^2"; break;
+        case PARSER_REG_POWI:   os << rname(t.a) << "^" << int(t.v); break;
+        case PARSER_REG_IF:
+            os << "if(" << rname(t.a) << ", " << rname(t.b) << ", " << rname(t.c) << ")";
+            break;
+        default:
+            os << "unknown";
+        }
+        os << "\n";
+    }
+    os << "  result: " << rname(hdr.result) << "\n";
+}
+
+}
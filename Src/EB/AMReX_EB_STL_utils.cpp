@@ -1,7 +1,9 @@
 #include <AMReX_EB_STL_utils.H>
 #include <AMReX_EB_triGeomOps_K.H>
 #include <AMReX_IntConv.H>
+#include <algorithm>
 #include <cstring>
+#include <numeric>
 
 namespace amrex
 {
@@ -89,6 +91,156 @@ namespace {
             return std::make_pair(false,0.0_rt);
         }
     }
+
+    // Does line ab intersect with the box?  The BVH boxes are padded so
+    // that round-off errors here do not exclude any triangles.
+    AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+    bool line_box_intersects (Real const a[3], Real const b[3], XDim3 const& lo, XDim3 const& hi)
+    {
+        Real const blo[] = {lo.x, lo.y, lo.z};
+        Real const bhi[] = {hi.x, hi.y, hi.z};
+        Real tmin = 0._rt;
+        Real tmax = 1._rt;
+        for (int d = 0; d < 3; ++d) {
+            Real dir = b[d] - a[d];
+            if (dir == 0._rt) {
+                if (a[d] < blo[d] || a[d] > bhi[d]) {
+                    return false;
+                }
+            } else {
+                Real t1 = (blo[d] - a[d]) / dir;
+                Real t2 = (bhi[d] - a[d]) / dir;
+                tmin = amrex::max(tmin, amrex::min(t1,t2));
+                tmax = amrex::min(tmax, amrex::max(t1,t2));
+                if (tmin > tmax) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Number of triangles intersected by line ab.  If bvh_nodes is null,
+    // all the triangles are tested.
+    AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+    int num_line_tri_intersects (Real a[3], Real b[3], int num_triangles,
+                                 STLtools::Triangle const* tri_pts,
+                                 STLtools::BVHNode const* bvh_nodes, int const* bvh_tri)
+    {
+        int num_intersects = 0;
+        if (bvh_nodes) {
+            int stack[STLtools::bvh_max_depth];
+            int nstack = 0;
+            stack[nstack++] = 0;
+            while (nstack > 0) {
+                STLtools::BVHNode const& node = bvh_nodes[stack[--nstack]];
+                if (line_box_intersects(a, b, node.boxlo, node.boxhi)) {
+                    if (node.ntri > 0) {
+                        for (int it = node.first; it < node.first+node.ntri; ++it) {
+                            if (line_tri_intersects(a, b, tri_pts[bvh_tri[it]])) {
+                                ++num_intersects;
+                            }
+                        }
+                    } else {
+                        stack[nstack++] = node.first;
+                        stack[nstack++] = node.first+1;
+                    }
+                }
+            }
+        } else {
+            for (int tr=0; tr < num_triangles; ++tr) {
+                if (line_tri_intersects(a, b, tri_pts[tr])) {
+                    ++num_intersects;
+                }
+            }
+        }
+        return num_intersects;
+    }
+
+    // Does the edge from p1 to p1+(x2-p1[idim])*e_idim intersect triangle tri?
+    AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+    std::pair<bool,Real> edge_tri_intersects (int idim, XDim3 const& p1, Real x2,
+                                              STLtools::Triangle const& tri,
+                                              XDim3 const& norm, Real dlevset)
+    {
+        if (idim == 0) {
+            return edge_tri_intersects(p1.x, x2, p1.y, p1.z,
+                                       tri.v1, tri.v2, tri.v3, norm, dlevset);
+        } else if (idim == 1) {
+            return edge_tri_intersects(p1.y, x2, p1.z, p1.x,
+                                       {tri.v1.y, tri.v1.z, tri.v1.x},
+                                       {tri.v2.y, tri.v2.z, tri.v2.x},
+                                       {tri.v3.y, tri.v3.z, tri.v3.x},
+                                       {  norm.y,   norm.z,   norm.x},
+                                       dlevset);
+        } else {
+            return edge_tri_intersects(p1.z, x2, p1.x, p1.y,
+                                       {tri.v1.z, tri.v1.x, tri.v1.y},
+                                       {tri.v2.z, tri.v2.x, tri.v2.y},
+                                       {tri.v3.z, tri.v3.x, tri.v3.y},
+                                       {  norm.z,   norm.x,   norm.y},
+                                       dlevset);
+        }
+    }
+
+    // Intercept of the edge from p1 to p1+(x2-p1[idim])*e_idim with the
+    // triangle of the smallest index that intersects it.  If bvh_nodes is
+    // null, all the triangles are tested.
+    AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+    std::pair<bool,Real> edge_intercept (int idim, XDim3 const& p1, Real x2, Real dlevset,
+                                         int num_triangles, STLtools::Triangle const* tri_pts,
+                                         XDim3 const* tri_norm,
+                                         STLtools::BVHNode const* bvh_nodes, int const* bvh_tri)
+    {
+        if (bvh_nodes) {
+            XDim3 p2 = p1;
+            if (idim == 0) {
+                p2.x = x2;
+            } else if (idim == 1) {
+                p2.y = x2;
+            } else {
+                p2.z = x2;
+            }
+            int itmin = num_triangles;
+            Real r = 0.0_rt;
+            int stack[STLtools::bvh_max_depth];
+            int nstack = 0;
+            stack[nstack++] = 0;
+            while (nstack > 0) {
+                STLtools::BVHNode const& node = bvh_nodes[stack[--nstack]];
+                if (p1.x <= node.boxhi.x && p2.x >= node.boxlo.x &&
+                    p1.y <= node.boxhi.y && p2.y >= node.boxlo.y &&
+                    p1.z <= node.boxhi.z && p2.z >= node.boxlo.z)
+                {
+                    if (node.ntri > 0) {
+                        for (int ib = node.first; ib < node.first+node.ntri; ++ib) {
+                            int it = bvh_tri[ib];
+                            if (it < itmin) {
+                                auto tmp = edge_tri_intersects(idim, p1, x2, tri_pts[it],
+                                                               tri_norm[it], dlevset);
+                                if (tmp.first) {
+                                    itmin = it;
+                                    r = tmp.second;
+                                }
+                            }
+                        }
+                    } else {
+                        stack[nstack++] = node.first;
+                        stack[nstack++] = node.first+1;
+                    }
+                }
+            }
+            return std::make_pair(itmin < num_triangles, r);
+        } else {
+            for (int it=0; it < num_triangles; ++it) {
+                auto tmp = edge_tri_intersects(idim, p1, x2, tri_pts[it], tri_norm[it], dlevset);
+                if (tmp.first) {
+                    return tmp;
+                }
+            }
+            return std::make_pair(false,0.0_rt);
+        }
+    }
 }
 
 void
@@ -307,6 +459,10 @@ STLtools::prepare ()
         amrex::Print() << "    Min: " << m_ptmin << " Max: " << m_ptmax << std::endl;
     }
 
+    if (m_use_bvh) {
+        build_bvh();
+    }
+
     // Choose a reference point by extending the normal vector of the first
     // triangle until it's slightly outside the bounding box.
     XDim3 cent0; // centroid of the first triangle
@@ -415,6 +571,110 @@ STLtools::prepare ()
     m_boundry_is_outside = num_isects % 2 == 0;
 }
 
+void
+STLtools::build_bvh ()
+{
+    BL_PROFILE("STLtools::build_bvh()");
+
+    // The node boxes are padded so that round-off errors in the
+    // line-box tests do not matter.
+    const Real pad = Real(100.) * std::numeric_limits<Real>::epsilon()
+        * std::max({m_ptmax.x-m_ptmin.x, m_ptmax.y-m_ptmin.y, m_ptmax.z-m_ptmin.z})
+        + std::numeric_limits<Real>::min();
+
+    Vector<XDim3> centroid(m_num_tri);
+    for (int i = 0; i < m_num_tri; ++i) {
+        Triangle const& tri = m_tri_pts_h[i];
+        centroid[i] = XDim3{(tri.v1.x + tri.v2.x + tri.v3.x) / 3._rt,
+                            (tri.v1.y + tri.v2.y + tri.v3.y) / 3._rt,
+                            (tri.v1.z + tri.v2.z + tri.v3.z) / 3._rt};
+    }
+
+    Vector<int> tri_idx(m_num_tri);
+    std::iota(tri_idx.begin(), tri_idx.end(), 0);
+
+    Vector<BVHNode> nodes;
+    nodes.reserve(2*(m_num_tri/bvh_leaf_size+1));
+    nodes.emplace_back();
+
+    // Top-down build.  Each node is split at the median of the triangle
+    // centroids in the direction of the largest extent, so the tree is
+    // balanced and its depth is about log2(m_num_tri/bvh_leaf_size).
+    struct Range {
+        int node, begin, end, depth;
+    };
+    Vector<Range> todo{{0, 0, m_num_tri, 1}};
+    int max_depth = 1;
+    while (!todo.empty())
+    {
+        Range const r = todo.back();
+        todo.pop_back();
+
+        constexpr Real big = std::numeric_limits<Real>::max();
+        XDim3 lo{big,big,big}, hi{-big,-big,-big};
+        XDim3 clo{big,big,big}, chi{-big,-big,-big};
+        for (int i = r.begin; i < r.end; ++i) {
+            Triangle const& tri = m_tri_pts_h[tri_idx[i]];
+            lo.x = amrex::min(lo.x, tri.v1.x, tri.v2.x, tri.v3.x);
+            lo.y = amrex::min(lo.y, tri.v1.y, tri.v2.y, tri.v3.y);
+            lo.z = amrex::min(lo.z, tri.v1.z, tri.v2.z, tri.v3.z);
+            hi.x = amrex::max(hi.x, tri.v1.x, tri.v2.x, tri.v3.x);
+            hi.y = amrex::max(hi.y, tri.v1.y, tri.v2.y, tri.v3.y);
+            hi.z = amrex::max(hi.z, tri.v1.z, tri.v2.z, tri.v3.z);
+            XDim3 const& c = centroid[tri_idx[i]];
+            clo.x = std::min(clo.x, c.x);
+            clo.y = std::min(clo.y, c.y);
+            clo.z = std::min(clo.z, c.z);
+            chi.x = std::max(chi.x, c.x);
+            chi.y = std::max(chi.y, c.y);
+            chi.z = std::max(chi.z, c.z);
+        }
+        nodes[r.node].boxlo = XDim3{lo.x-pad, lo.y-pad, lo.z-pad};
+        nodes[r.node].boxhi = XDim3{hi.x+pad, hi.y+pad, hi.z+pad};
+
+        const int n = r.end - r.begin;
+        if (n <= bvh_leaf_size) {
+            nodes[r.node].first = r.begin;
+            nodes[r.node].ntri = n;
+            continue;
+        }
+
+        int dir = 0;
+        if (chi.y-clo.y > chi.x-clo.x) { dir = 1; }
+        if (chi.z-clo.z > std::max(chi.x-clo.x, chi.y-clo.y)) { dir = 2; }
+        const int mid = r.begin + n/2;
+        std::nth_element(tri_idx.begin()+r.begin, tri_idx.begin()+mid, tri_idx.begin()+r.end,
+                         [&] (int a, int b) {
+                             auto const& ca = centroid[a];
+                             auto const& cb = centroid[b];
+                             return (dir == 0) ? (ca.x < cb.x)
+                                 :  (dir == 1) ? (ca.y < cb.y) : (ca.z < cb.z);
+                         });
+
+        const int left = static_cast<int>(nodes.size());
+        nodes.emplace_back();
+        nodes.emplace_back();
+        nodes[r.node].first = left;
+        nodes[r.node].ntri = 0;
+        todo.push_back(Range{left  , r.begin, mid  , r.depth+1});
+        todo.push_back(Range{left+1, mid    , r.end, r.depth+1});
+        max_depth = std::max(max_depth, r.depth+1);
+    }
+
+    // The traversal stack needs at most one entry per level.
+    AMREX_ALWAYS_ASSERT(max_depth < bvh_max_depth);
+
+    if (amrex::Verbose() > 0) {
+        amrex::Print() << "    BVH: " << nodes.size() << " nodes, depth " << max_depth << std::endl;
+    }
+
+    m_bvh_nodes_d.resize(nodes.size());
+    m_bvh_tri_d.resize(tri_idx.size());
+    Gpu::copyAsync(Gpu::hostToDevice, nodes.begin(), nodes.end(), m_bvh_nodes_d.begin());
+    Gpu::copyAsync(Gpu::hostToDevice, tri_idx.begin(), tri_idx.end(), m_bvh_tri_d.begin());
+    Gpu::streamSynchronize();
+}
+
 void
 STLtools::fill (MultiFab& mf, IntVect const& nghost, Geometry const& geom,
                 Real outside_value, Real inside_value) const
@@ -425,6 +685,8 @@ STLtools::fill (MultiFab& mf, IntVect const& nghost, Geometry const& geom,
     const auto dx  = geom.CellSizeArray();
 
     const Triangle* tri_pts = m_tri_pts_d.data();
+    const BVHNode* bvh_nodes = m_use_bvh ? m_bvh_nodes_d.data() : nullptr;
+    const int* bvh_tri = m_bvh_tri_d.data();
     XDim3 ptmin = m_ptmin;
     XDim3 ptmax = m_ptmax;
     XDim3 ptref = m_ptref;
@@ -449,11 +711,8 @@ STLtools::fill (MultiFab& mf, IntVect const& nghost, Geometry const& geom,
             coords[2] >= ptmin.z && coords[2] <= ptmax.z)
         {
             Real pr[]={ptref.x, ptref.y, ptref.z};
-            for (int tr=0; tr < num_triangles; ++tr) {
-                if (line_tri_intersects(pr, coords, tri_pts[tr])) {
-                    ++num_intersects;
-                }
-            }
+            num_intersects = num_line_tri_intersects(pr, coords, num_triangles, tri_pts,
+                                                     bvh_nodes, bvh_tri);
         }
         ma[box_no](i,j,k) = (num_intersects % 2 == 0) ? reference_value : other_value;
     });
@@ -493,6 +752,8 @@ STLtools::getBoxType (Box const& box, Geometry const& geom, RunOn) const
     {
         int num_triangles = m_num_tri;
         const Triangle* tri_pts = m_tri_pts_d.data();
+        const BVHNode* bvh_nodes = m_use_bvh ? m_bvh_nodes_d.data() : nullptr;
+        const int* bvh_tri = m_bvh_tri_d.data();
         XDim3 ptmin = m_ptmin;
         XDim3 ptmax = m_ptmax;
         XDim3 ptref = m_ptref;
@@ -519,11 +780,8 @@ STLtools::getBoxType (Box const& box, Geometry const& geom, RunOn) const
                 coords[2] >= ptmin.z && coords[2] <= ptmax.z)
             {
                 Real pr[]={ptref.x, ptref.y, ptref.z};
-                for (int tr=0; tr < num_triangles; ++tr) {
-                    if (line_tri_intersects(pr, coords, tri_pts[tr])) {
-                        ++num_intersects;
-                    }
-                }
+                num_intersects = num_line_tri_intersects(pr, coords, num_triangles, tri_pts,
+                                                         bvh_nodes, bvh_tri);
             }
 
             return (num_intersects % 2 == 0) ? ref_value : 1-ref_value;
@@ -550,6 +808,8 @@ STLtools::fillFab (BaseFab<Real>& levelset, const Geometry& geom, RunOn, Box con
     const auto dx  = geom.CellSizeArray();
 
     const Triangle* tri_pts = m_tri_pts_d.data();
+    const BVHNode* bvh_nodes = m_use_bvh ? m_bvh_nodes_d.data() : nullptr;
+    const int* bvh_tri = m_bvh_tri_d.data();
     XDim3 ptmin = m_ptmin;
     XDim3 ptmax = m_ptmax;
     XDim3 ptref = m_ptref;
@@ -574,11 +834,8 @@ STLtools::fillFab (BaseFab<Real>& levelset, const Geometry& geom, RunOn, Box con
             coords[2] >= ptmin.z && coords[2] <= ptmax.z)
         {
             Real pr[]={ptref.x, ptref.y, ptref.z};
-            for (int tr=0; tr < num_triangles; ++tr) {
-                if (line_tri_intersects(pr, coords, tri_pts[tr])) {
-                    ++num_intersects;
-                }
-            }
+            num_intersects = num_line_tri_intersects(pr, coords, num_triangles, tri_pts,
+                                                     bvh_nodes, bvh_tri);
         }
         a(i,j,k) = (num_intersects % 2 == 0) ? reference_value : other_value;
     });
@@ -597,6 +854,8 @@ STLtools::getIntercept (Array<Array4<Real>,AMREX_SPACEDIM> const& inter_arr,
 
     const Triangle* tri_pts = m_tri_pts_d.data();
     const XDim3* tri_norm = m_tri_normals_d.data();
+    const BVHNode* bvh_nodes = m_use_bvh ? m_bvh_nodes_d.data() : nullptr;
+    const int* bvh_tri = m_bvh_tri_d.data();
 
     for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
         Array4<Real> const& inter = inter_arr[idim];
@@ -614,63 +873,26 @@ STLtools::getIntercept (Array<Array4<Real>,AMREX_SPACEDIM> const& inter_arr,
                          plo[2]+static_cast<Real>(k)*dx[2]
 #endif
                 };
+                Real x1, x2, dlevset;
                 if (idim == 0) {
-                    Real x2 = plo[0]+static_cast<Real>(i+1)*dx[0];
-                    int it;
-                    for (it=0; it < num_triangles; ++it) {
-                        auto const& tri = tri_pts[it];
-                        auto tmp = edge_tri_intersects(p1.x, x2, p1.y, p1.z,
-                                                       tri.v1, tri.v2, tri.v3,
-                                                       tri_norm[it],
-                                                       lst(i+1,j,k)-lst(i,j,k));
-                        if (tmp.first) {
-                            r = tmp.second;
-                            break;
-                        }
-                    }
-                    if (it == num_triangles) {
-                        r = (lst(i,j,k) > 0._rt) ? p1.x : x2;
-                    }
+                    x1 = p1.x;
+                    x2 = plo[0]+static_cast<Real>(i+1)*dx[0];
+                    dlevset = lst(i+1,j,k)-lst(i,j,k);
                 } else if (idim == 1) {
-                    Real y2 = plo[1]+static_cast<Real>(j+1)*dx[1];
-                    int it;
-                    for (it=0; it < num_triangles; ++it) {
-                        auto const& tri = tri_pts[it];
-                        auto const& norm = tri_norm[it];
-                        auto tmp = edge_tri_intersects(p1.y, y2, p1.z, p1.x,
-                                                       {tri.v1.y, tri.v1.z, tri.v1.x},
-                                                       {tri.v2.y, tri.v2.z, tri.v2.x},
-                                                       {tri.v3.y, tri.v3.z, tri.v3.x},
-                                                       {  norm.y,   norm.z,   norm.x},
-                                                       lst(i,j+1,k)-lst(i,j,k));
-                        if (tmp.first) {
-                            r = tmp.second;
-                            break;
-                        }
-                    }
-                    if (it == num_triangles) {
-                        r = (lst(i,j,k) > 0._rt) ? p1.y : y2;
-                    }
+                    x1 = p1.y;
+                    x2 = plo[1]+static_cast<Real>(j+1)*dx[1];
+                    dlevset = lst(i,j+1,k)-lst(i,j,k);
                 } else {
-                    Real z2 = plo[2]+static_cast<Real>(k+1)*dx[2];
-                    int it;
-                    for (it=0; it < num_triangles; ++it) {
-                        auto const& tri = tri_pts[it];
-                        auto const& norm = tri_norm[it];
-                        auto tmp = edge_tri_intersects(p1.z, z2, p1.x, p1.y,
-                                                       {tri.v1.z, tri.v1.x, tri.v1.y},
-                                                       {tri.v2.z, tri.v2.x, tri.v2.y},
-                                                       {tri.v3.z, tri.v3.x, tri.v3.y},
-                                                       {  norm.z,   norm.x,   norm.y},
-                                                       lst(i,j,k+1)-lst(i,j,k));
-                        if (tmp.first) {
-                            r = tmp.second;
-                            break;
-                        }
-                    }
-                    if (it == num_triangles) {
-                        r = (lst(i,j,k) > 0._rt) ? p1.z : z2;
-                    }
+                    x1 = p1.z;
+                    x2 = plo[2]+static_cast<Real>(k+1)*dx[2];
+                    dlevset = lst(i,j,k+1)-lst(i,j,k);
+                }
+                auto tmp = edge_intercept(idim, p1, x2, dlevset, num_triangles,
+                                          tri_pts, tri_norm, bvh_nodes, bvh_tri);
+                if (tmp.first) {
+                    r = tmp.second;
+                } else {
+                    r = (lst(i,j,k) > 0._rt) ? x1 : x2;
                 }
             }
             inter(i,j,k) = r;
@@ -91,6 +91,8 @@
              mlmg->setBottomSolver(MLMG::BottomSolver::hypre);
          } else if (s == 4) {
              mlmg->setBottomSolver(MLMG::BottomSolver::petsc);
+         } else if (s == 5) {
+             mlmg->setBottomSolver(MLMG::BottomSolver::amg);
          } else {
              amrex::Abort("amrex_fi_multigrid_set_bottom_solver: unknown bottom solver");
          }
@@ -1177,6 +1177,8 @@ MLEBABecLap::update ()
 {
     if (MLCellABecLap::needsUpdate()) MLCellABecLap::update();
 
+    clearSmootherData();
+
     averageDownCoeffs();
 
     m_is_singular.clear();
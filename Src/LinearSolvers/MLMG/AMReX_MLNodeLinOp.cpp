@@ -95,6 +95,8 @@ MLNodeLinOp::define (const Vector<Geometry>& a_geom,
 void
 MLNodeLinOp::prepareForSolve ()
 {
+    clearSmootherData();
+
     for (int amrlev = 0; amrlev < m_num_amr_levels-1; ++amrlev) {
         fixUpResidualMask(amrlev, *m_norm_fine_mask[amrlev]);
     }
@@ -165,6 +167,11 @@ void
 MLNodeLinOp::smooth (int amrlev, int mglev, MultiFab& sol, const MultiFab& rhs,
                      bool skip_fillboundary) const
 {
+    if (m_smoother != Smoother::Default) {
+        polySmooth(amrlev, mglev, sol, rhs, StateMode::Correction);
+        nodalSync(amrlev, mglev, sol);
+        return;
+    }
     if (!skip_fillboundary) {
         applyBC(amrlev, mglev, sol, BCMode::Homogeneous, StateMode::Correction);
     }
@@ -228,6 +228,10 @@ MLNodeTensorLaplacian::smooth (int amrlev, int mglev, MultiFab& sol, const Multi
                                bool skip_fillboundary) const
 {
     BL_PROFILE("MLNodeTensorLaplacian::smooth()");
+    if (m_smoother != Smoother::Default) {
+        MLNodeLinOp::smooth(amrlev, mglev, sol, rhs, skip_fillboundary);
+        return;
+    }
     for (int redblack = 0; redblack < 4; ++redblack) {
         if (!skip_fillboundary) {
             applyBC(amrlev, mglev, sol, BCMode::Homogeneous, StateMode::Correction);
@@ -158,6 +158,8 @@ void ParticleCopyPlan::buildMPIStart (const ParticleBufferMap& map, Long psize)
         m_build_rreqs[i] = ParallelDescriptor::Arecv((char*) (m_rcv_data.dataPtr() + offset), Cnt, Who, SeqNum, ParallelContext::CommunicatorSub()).req();
     }
 
+    m_build_progress_id = CommProgress::Register({{m_build_rreqs.data(), m_nrcvs}});
+
     for (auto i : m_neighbor_procs)
     {
         if (i == MyProc) continue;
@@ -214,6 +216,8 @@ void ParticleCopyPlan::buildMPIFinish (const ParticleBufferMap& map) // NOLINT(r
     const int NProcs = ParallelContext::NProcsSub();
     if (NProcs == 1) return;
 
+    CommProgress::Unregister(m_build_progress_id);
+
     if (m_nrcvs > 0)
     {
         ParallelDescriptor::Waitall(m_build_rreqs, m_build_stats);
@@ -371,6 +375,8 @@ void amrex::communicateParticlesFinish (const ParticleCopyPlan& plan)
 {
     BL_PROFILE("amrex::communicateParticlesFinish");
 #ifdef AMREX_USE_MPI
+    CommProgress::Unregister(plan.m_particle_progress_id);
+
     if (plan.m_nrcvs > 0)
     {
         ParallelDescriptor::Waitall(plan.m_particle_rreqs, plan.m_particle_stats);
@@ -0,0 +1,89 @@
+#include <AMReX_ParticleIndex.H>
+#include <AMReX_FileSystem.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_Utility.H>
+
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace amrex {
+
+void WriteParticleIndex (const std::string& level_dir, const Vector<ParticleGridIndex>& index)
+{
+    std::string FileName = level_dir;
+    if ( ! FileName.empty() && FileName[FileName.size()-1] != '/') FileName += '/';
+    FileName += "Particle_Index";
+
+    std::ofstream ofs(FileName.c_str(), std::ios::out|std::ios::trunc);
+    if ( ! ofs.good()) amrex::FileOpenFailed(FileName);
+
+    ofs.precision(std::numeric_limits<Real>::max_digits10);
+    ofs << index.size() << '\n';
+    for (const auto& gi : index)
+    {
+        ofs << gi.file << ' ' << gi.count << ' ' << gi.offset;
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) ofs << ' ' << gi.bbox.lo(d);
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) ofs << ' ' << gi.bbox.hi(d);
+        ofs << '\n';
+    }
+
+    ofs.close();
+    if ( ! ofs.good()) amrex::Abort("WriteParticleIndex: problem writing " + FileName);
+}
+
+Vector<ParticleGridIndex>
+ReadParticleIndex (const std::string& dir, const std::string& name, int lev)
+{
+    std::string FileName = dir;
+    if ( ! FileName.empty() && FileName[FileName.size()-1] != '/') FileName += '/';
+    FileName += name;
+    FileName += "/Level_";
+    FileName = amrex::Concatenate(FileName, lev, 1);
+    const std::string LevelDir = FileName;
+    FileName += "/Particle_Index";
+
+    // Levels without particles have no directory.
+    Vector<ParticleGridIndex> index;
+    if ( ! amrex::FileExists(LevelDir)) return index;
+    if ( ! amrex::FileExists(FileName)) {
+        amrex::Abort("ReadParticleIndex: " + LevelDir + " has particles but no Particle_Index");
+    }
+
+    Vector<char> fileCharPtr;
+    ParallelDescriptor::ReadAndBcastFile(FileName, fileCharPtr);
+    std::string fileCharPtrString(fileCharPtr.dataPtr());
+    std::istringstream is(fileCharPtrString, std::istringstream::in);
+
+    Long ngrids = 0;
+    is >> ngrids;
+    if (is.fail() || ngrids < 0) amrex::Abort("ReadParticleIndex: problem reading " + FileName);
+    index.resize(ngrids);
+    for (auto& gi : index)
+    {
+        is >> gi.file >> gi.count >> gi.offset;
+        Real lo[AMREX_SPACEDIM], hi[AMREX_SPACEDIM];
+        for (auto& x : lo) is >> x;
+        for (auto& x : hi) is >> x;
+        gi.bbox = RealBox(lo, hi);
+    }
+
+    // A short file fails the reads of the missing rows.
+    if (is.fail()) amrex::Abort("ReadParticleIndex: problem reading " + FileName);
+    return index;
+}
+
+Vector<int>
+ParticleGridsInRegion (const Vector<ParticleGridIndex>& index, const RealBox& region)
+{
+    Vector<int> grids;
+    for (int i = 0, N = static_cast<int>(index.size()); i < N; ++i)
+    {
+        if (index[i].count > 0 && index[i].bbox.intersects(region)) {
+            grids.push_back(i);
+        }
+    }
+    return grids;
+}
+
+}
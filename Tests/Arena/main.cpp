@@ -0,0 +1,168 @@
+#include <AMReX.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_CArena.H>
+#include <AMReX_OpenMP.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_Print.H>
+#include <AMReX_Utility.H>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace amrex;
+
+namespace {
+    int niters = 200000;
+    int nlive = 8;
+    Long max_size = 256*1024;
+    bool touch = true;
+
+    struct Block {
+        void* p = nullptr;
+        std::size_t sz = 0;
+        std::uint64_t tag = 0;
+    };
+
+    // Put a tag at both ends of the block, so that we can detect blocks
+    // that are given out twice.
+    void set_tag (Block const& b)
+    {
+        if (touch) {
+            auto* p = static_cast<char*>(b.p);
+            std::memcpy(p, &b.tag, sizeof(b.tag));
+            std::memcpy(p+b.sz-sizeof(b.tag), &b.tag, sizeof(b.tag));
+        }
+    }
+
+    void check_tag (Block const& b)
+    {
+        if (touch) {
+            auto const* p = static_cast<char const*>(b.p);
+            std::uint64_t lo, hi;
+            std::memcpy(&lo, p, sizeof(lo));
+            std::memcpy(&hi, p+b.sz-sizeof(hi), sizeof(hi));
+            if (lo != b.tag || hi != b.tag) {
+                amrex::Abort("Arena test: memory block was corrupted");
+            }
+        }
+    }
+
+    // Each thread keeps nlive blocks alive, and repeatedly replaces the
+    // oldest one with a new block of random size, like temporary fabs
+    // allocated inside MFIter loops.  The sizes are log-uniformly
+    // distributed between 16 bytes and max_size.  At the end, the blocks
+    // are freed by a different thread.
+    double run (Arena* arena)
+    {
+        BL_PROFILE("ArenaTest::run()");
+
+        const int nthreads = OpenMP::get_max_threads();
+        std::vector<std::vector<Block>> live(nthreads);
+
+        double t0 = amrex::second();
+#ifdef AMREX_USE_OMP
+#pragma omp parallel
+#endif
+        {
+            const int tid = OpenMP::get_thread_num();
+            std::mt19937 gen(1234+tid);
+            std::uniform_real_distribution<double> dist(std::log(16.), std::log(double(max_size)));
+            auto& blocks = live[tid];
+            blocks.resize(nlive);
+            std::uint64_t tag = std::uint64_t(tid) << 40;
+            for (int it = 0; it < niters; ++it) {
+                auto& b = blocks[it % nlive];
+                if (b.p) {
+                    check_tag(b);
+                    arena->free(b.p);
+                }
+                b.sz = static_cast<std::size_t>(std::exp(dist(gen)));
+                b.sz = std::max(b.sz, sizeof(b.tag));
+                b.p = arena->alloc(b.sz);
+                b.tag = ++tag;
+                set_tag(b);
+            }
+#ifdef AMREX_USE_OMP
+#pragma omp barrier
+#endif
+            for (auto const& b : live[(tid+1) % nthreads]) {
+                if (b.p) {
+                    check_tag(b);
+                    arena->free(b.p);
+                }
+            }
+        }
+        return amrex::second() - t0;
+    }
+
+    void test (std::string const& name, CArena* arena)
+    {
+        auto in_use = [=] () {
+            return arena->heap_space_actually_used() - arena->heap_space_cached();
+        };
+        const std::size_t in_use_before = in_use();
+        double t = run(arena);
+        amrex::Print() << name << ": " << t << " seconds, "
+                       << double(niters)*OpenMP::get_max_threads()/t*1.e-6
+                       << " million alloc/free pairs per second\n";
+        if (ParallelDescriptor::IOProcessor()) {
+            arena->PrintUsage(amrex::OutStream(), name, "    ");
+        }
+        if (in_use() != in_use_before) {
+            amrex::Abort("Arena test: " + name + " has leaked memory");
+        }
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    amrex::Initialize(argc, argv, true, MPI_COMM_WORLD, [] () {
+        ParmParse pp("amrex");
+        if (!pp.contains("the_pinned_arena_thread_cache_size")) {
+            pp.add("the_pinned_arena_thread_cache_size", Long(16*1024*1024));
+        }
+    });
+    {
+        ParmParse pp;
+        pp.query("niters", niters);
+        pp.query("nlive", nlive);
+        pp.query("max_size", max_size);
+        pp.query("touch", touch);
+
+        Long cache_size = 16*1024*1024;
+        Long cache_max_block = 1024*1024;
+        pp.query("cache_size", cache_size);
+        pp.query("cache_max_block", cache_max_block);
+
+        amrex::Print() << "Arena test with " << OpenMP::get_max_threads() << " threads, "
+                       << niters << " iterations per thread\n";
+
+        {
+            CArena arena(0, ArenaInfo{}.SetCpuMemory());
+            test("CArena", &arena);
+        }
+
+        {
+            CArena arena(0, ArenaInfo{}.SetCpuMemory().SetThreadCache(cache_max_block, cache_size));
+            test("CArena with thread caches", &arena);
+            arena.freeUnused();
+            if (arena.heap_space_used() != 0 || arena.heap_space_actually_used() != 0) {
+                amrex::Abort("Arena test: freeUnused did not release all memory");
+            }
+        }
+
+        // The pinned arena is registered with TinyProfiler.
+        {
+            auto* arena = dynamic_cast<CArena*>(The_Pinned_Arena());
+            if (arena) {
+                test("The_Pinned_Arena", arena);
+            }
+        }
+    }
+    amrex::Finalize();
+}
@@ -4,6 +4,7 @@
 #include <AMReX_ParmParse.H>
 #include <AMReX_BLProfiler.H>
 
+#include <atomic>
 #include <thread>
 #include <future>
 
@@ -179,6 +180,31 @@ void main_main ()
     }
     ParallelDescriptor::Barrier();
 
+// ***************************************************************
+
+    amrex::Print() << " Direct Write " << std::endl;
+    {
+        BL_PROFILE_REGION("vismf-direct");
+        bool const old_direct = VisMF::GetUseDirectWrite();
+        VisMF::SetUseDirectWrite(true);
+        {
+            BL_PROFILE_VAR("vismf-direct-write", blp1);
+            for (int m = 0; m < nwrites; ++m) {
+                VisMF::Write(mfs[m], std::string("vismfdata/direct-" + std::to_string(m)));
+            }
+            ParallelDescriptor::Barrier();
+        }
+        VisMF::SetUseDirectWrite(old_direct);
+
+        for (int m = 0; m < nwrites; ++m) {
+            MultiFab mf_in(mfs[m].boxArray(), mfs[m].DistributionMap(), 1, 0);
+            VisMF::Read(mf_in, std::string("vismfdata/direct-" + std::to_string(m)));
+            MultiFab::Subtract(mf_in, mfs[m], 0, 0, 1, 0);
+            AMREX_ALWAYS_ASSERT(mf_in.norminf(0) == 0);
+        }
+    }
+    ParallelDescriptor::Barrier();
+
 // ***************************************************************
 
     amrex::Print() << " AsyncOut " << std::endl;
@@ -206,4 +232,88 @@ void main_main ()
         }
     }
     ParallelDescriptor::Barrier();
+
+// ***************************************************************
+
+    amrex::Print() << " AsyncOut with bounded staging memory " << std::endl;
+    {
+        BL_PROFILE_REGION("vismf-async-staged");
+        // Room for about two boxes, so that copying has to wait for the writer.
+        Long const old_max_staging = AsyncOut::MaxStagingBytes();
+        Long const box_bytes = Box(IntVect(0),IntVect(max_grid_size-1)).numPts() * Long(sizeof(Real));
+        AsyncOut::SetMaxStagingBytes(2*box_bytes);
+        AsyncOut::ResetStagingStats();
+        for (int m = 0; m < nwrites; ++m) {
+            VisMF::AsyncWrite(mfs[m], std::string("vismfdata/staged-" + std::to_string(m)));
+        }
+        {
+            BL_PROFILE_VAR("vismf-staged-work", blp2);
+            for (int m = 0; m < nwrites; ++m) {
+                for (int i = 0; i < nwork*2; ++i) {
+                    Real min = mfs[m].min(0);
+                    Real max = mfs[m].max(0);
+                    if (mf_min[m] != min)
+                        { amrex::AllPrint() << "Min failed: " << min << " != " << mf_min[m] << std::endl; }
+                    if (mf_max[m] != max)
+                        { amrex::AllPrint() << "Max failed: " << max << " != " << mf_max[m] << std::endl; }
+                }
+            }
+        }
+        {
+            BL_PROFILE_VAR("vismf-staged-finish", blp3);
+            AsyncOut::Finish();
+        }
+        AsyncOut::SetMaxStagingBytes(old_max_staging);
+
+        auto const stats = AsyncOut::GetStagingStats();
+        if (AsyncOut::UseAsyncOut()) {
+            AMREX_ALWAYS_ASSERT(stats.peak_bytes <= 2*box_bytes);
+        }
+        amrex::Print() << "  Proc. 0 staged " << stats.nbytes << " bytes in " << stats.nchunks
+                       << " chunks, peak " << stats.peak_bytes << " bytes, stalled "
+                       << stats.stall_time << " s, wrote " << stats.write_time << " s" << std::endl;
+
+        ParallelDescriptor::Barrier();
+        for (int m = 0; m < nwrites; ++m) {
+            MultiFab mf_in(mfs[m].boxArray(), mfs[m].DistributionMap(), 1, 0);
+            VisMF::Read(mf_in, std::string("vismfdata/staged-" + std::to_string(m)));
+            MultiFab::Subtract(mf_in, mfs[m], 0, 0, 1, 0);
+            AMREX_ALWAYS_ASSERT(mf_in.norminf(0) == 0);
+        }
+    }
+    ParallelDescriptor::Barrier();
+
+// ***************************************************************
+
+    amrex::Print() << " AsyncOut with several streams " << std::endl;
+    if (AsyncOut::UseAsyncOut())
+    {
+        BL_PROFILE_REGION("vismf-async-streams");
+        // Each write goes to its own stream, the odd ones with a higher priority.
+        for (int m = 0; m < nwrites; ++m) {
+            AsyncOut::ScopedStream stream(m, m%2);
+            VisMF::AsyncWrite(mfs[m], std::string("vismfdata/stream-" + std::to_string(m)));
+        }
+
+        // A job that depends on jobs in other streams.
+        std::atomic<int> ndone{0};
+        AsyncOut::JobId first = AsyncOut::Submit([&] () { ++ndone; }, 0);
+        AsyncOut::JobId second = AsyncOut::Submit([&] () { ++ndone; }, 1);
+        int seen = -1;
+        AsyncOut::JobId last = AsyncOut::Submit([&] () { seen = ndone; }, 2, 0, {first, second});
+        AsyncOut::Finish(last);
+        AMREX_ALWAYS_ASSERT(seen == 2);
+        AsyncOut::Finish();
+
+        ParallelDescriptor::Barrier();
+        for (int m = 0; m < nwrites; ++m) {
+            MultiFab mf_in(mfs[m].boxArray(), mfs[m].DistributionMap(), 1, 0);
+            VisMF::Read(mf_in, std::string("vismfdata/stream-" + std::to_string(m)));
+            MultiFab::Subtract(mf_in, mfs[m], 0, 0, 1, 0);
+            AMREX_ALWAYS_ASSERT(mf_in.norminf(0) == 0);
+        }
+        amrex::Print() << "  " << nwrites << " writes on " << AsyncOut::NStreams()
+                       << " streams" << std::endl;
+    }
+    ParallelDescriptor::Barrier();
 }
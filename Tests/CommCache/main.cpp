@@ -0,0 +1,318 @@
+#include <AMReX.H>
+#include <AMReX_FileSystem.H>
+#include <AMReX_GpuContainers.H>
+#include <AMReX_MultiFab.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_Print.H>
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace amrex;
+
+//
+// Tests the size limits of the FillBoundary and ParallelCopy metadata
+// caches, and the on-disk store of the metadata in fabarray.comm_cache_dir.
+// Each case is a separate amrex::Initialize/Finalize, so that the store is
+// read back as in a restart.  The data after every communication must be
+// the same as without limits and without the store.
+//
+
+namespace {
+
+const std::string cache_dir("comm_cache");
+
+struct Result
+{
+    std::vector<Real> data;
+    FabArrayBase::CacheStats fb{"FBCache"};
+    FabArrayBase::CacheStats cpc{"CopyCache"};
+};
+
+void append (std::vector<Real>& data, MultiFab const& mf)
+{
+    for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        auto const& fab = mf[mfi];
+        const auto n = data.size();
+        data.resize(n + fab.size());
+        Gpu::copyAsync(Gpu::deviceToHost, fab.dataPtr(), fab.dataPtr() + fab.size(),
+                       data.data() + n);
+    }
+    Gpu::streamSynchronize();
+}
+
+void fill (MultiFab& mf)
+{
+    mf.setVal(Real(-1.0));
+    for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        auto const& a = mf.array(mfi);
+        ParallelFor(mfi.validbox(), mf.nComp(), [=] AMREX_GPU_DEVICE (int i, int j, int k, int n)
+        {
+            a(i,j,k,n) = Real(i + 100*j + 10000*k + 1000000*n);
+        });
+    }
+}
+
+//! One run with the parameters added by params.  The store can be changed
+//! by before, which is called before any metadata are built, and checked by
+//! after.
+Result run (int argc, char* argv[], std::function<void()> const& params,
+            std::function<void()> const& before = [] () {},
+            std::function<void(Result const&)> const& after = [] (Result const&) {})
+{
+    Result r;
+    amrex::Initialize(argc, argv, true, MPI_COMM_WORLD, params);
+    before();
+    {
+        int n_cell = 32;
+        int max_grid_size = 16;
+        int nsteps = 3;
+        {
+            ParmParse pp;
+            pp.query("n_cell", n_cell);
+            pp.query("max_grid_size", max_grid_size);
+            pp.query("nsteps", nsteps);
+        }
+
+        Box domain(IntVect(0), IntVect(n_cell-1));
+        Periodicity period(domain.length());
+
+        BoxArray ba1(domain);
+        ba1.maxSize(max_grid_size);
+        BoxArray ba2(domain);
+        ba2.maxSize(max_grid_size/2);
+        DistributionMapping dm1(ba1);
+        DistributionMapping dm2(ba2);
+
+        MultiFab a(ba1, dm1, 2, 2);
+        MultiFab b(ba2, dm2, 2, 1);
+        MultiFab c(ba2, dm2, 2, 0);
+
+        for (int step = 0; step < nsteps; ++step)
+        {
+            fill(a);
+            a.FillBoundary(period);
+            append(r.data, a);
+
+            fill(a);
+            a.FillBoundary();
+            append(r.data, a);
+
+            fill(a);
+            a.FillBoundary(IntVect(1), period);
+            append(r.data, a);
+
+            fill(a);
+            a.FillBoundary(period);
+            b.setVal(Real(-1.0));
+            b.ParallelCopy(a, 0, 0, 2, IntVect(2), IntVect(1), period);
+            append(r.data, b);
+
+            c.setVal(Real(-1.0));
+            c.ParallelCopy(a, 0, 0, 2);
+            append(r.data, c);
+
+            // The pending communications pin their metadata, so that
+            // building new ones cannot evict them.
+            fill(a);
+            fill(b);
+            a.FillBoundary_nowait(period);
+            b.FillBoundary(period);
+            a.FillBoundary_finish();
+            append(r.data, a);
+            append(r.data, b);
+
+            c.setVal(Real(-1.0));
+            b.setVal(Real(-1.0));
+            c.ParallelCopy_nowait(a, 0, 0, 2, IntVect(2), IntVect(0), period);
+            b.ParallelCopy(a, 0, 0, 2);
+            c.ParallelCopy_finish();
+            append(r.data, c);
+            append(r.data, b);
+        }
+
+        r.fb  = FabArrayBase::m_FBC_stats;
+        r.cpc = FabArrayBase::m_CPC_stats;
+    }
+    after(r);
+    ParallelDescriptor::Barrier();
+    amrex::Finalize();
+    return r;
+}
+
+std::string cache_file ()
+{
+    return cache_dir + "/CommMetaData_" + std::to_string(ParallelDescriptor::MyProc());
+}
+
+Long file_size (std::string const& name)
+{
+    std::ifstream ifs(name, std::ios::in | std::ios::binary | std::ios::ate);
+    return ifs.good() ? static_cast<Long>(ifs.tellg()) : Long(-1);
+}
+
+void write_bytes (std::string const& name, Long pos, std::string const& bytes)
+{
+    std::fstream fs(name, std::ios::in | std::ios::out | std::ios::binary);
+    AMREX_ALWAYS_ASSERT(fs.good());
+    fs.seekp(pos);
+    fs.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    AMREX_ALWAYS_ASSERT(fs.good());
+}
+
+void truncate_file (std::string const& name, Long size)
+{
+    std::string bytes(size, '\0');
+    {
+        std::ifstream ifs(name, std::ios::in | std::ios::binary);
+        ifs.read(bytes.data(), size);
+        AMREX_ALWAYS_ASSERT(ifs.good());
+    }
+    std::ofstream ofs(name, std::ios::out | std::ios::binary | std::ios::trunc);
+    ofs.write(bytes.data(), size);
+    AMREX_ALWAYS_ASSERT(ofs.good());
+}
+
+void check_same (Result const& r, Result const& ref, const char* what)
+{
+    if (r.data != ref.data) {
+        amrex::Print(Print::AllProcs) << "CommCache: " << what << " differs from the reference\n";
+        amrex::Abort("CommCache test failed");
+    }
+}
+
+}
+
+int main (int argc, char* argv[])
+{
+#ifdef AMREX_USE_MPI
+    MPI_Init(&argc, &argv);
+#endif
+
+    auto no_params = [] () {};
+
+    auto limits = [] (bool neighbor_collective) {
+        return [=] () {
+            ParmParse pp("fabarray");
+            pp.add("fb_cache_max_bytes", 1);
+            pp.add("cpc_cache_max_bytes", 1);
+            pp.add("neighbor_collective", neighbor_collective);
+        };
+    };
+
+    auto disk = [] (Long max_file_bytes) {
+        return [=] () {
+            ParmParse pp("fabarray");
+            pp.add("comm_cache_dir", cache_dir);
+            pp.add("comm_cache_max_file_bytes", max_file_bytes);
+        };
+    };
+
+    const Result ref = run(argc, argv, no_params);
+    AMREX_ALWAYS_ASSERT(ref.fb.nevict == 0 && ref.cpc.nevict == 0);
+
+    // ---- Every new entry evicts all the others that are not pinned.
+    {
+        Result r = run(argc, argv, limits(false));
+        check_same(r, ref, "FB/CPC with cache limits");
+        AMREX_ALWAYS_ASSERT(r.fb.nevict > 0 && r.cpc.nevict > 0);
+        AMREX_ALWAYS_ASSERT(r.fb.nbuild > ref.fb.nbuild && r.cpc.nbuild > ref.cpc.nbuild);
+    }
+
+#ifdef AMREX_USE_MPI
+    // ---- The processes agree on the entries to evict.
+    {
+        Result r = run(argc, argv, limits(true));
+        check_same(r, ref, "FB/CPC with cache limits and neighbor collectives");
+        AMREX_ALWAYS_ASSERT(r.fb.nevict > 0 && r.cpc.nevict > 0);
+    }
+#endif
+
+    auto remove_dir = [] () {
+        if (ParallelDescriptor::IOProcessor()) {
+            FileSystem::RemoveAll(cache_dir);
+        }
+        ParallelDescriptor::Barrier();
+    };
+
+    const Long no_cap = -1;
+    Long full_size = 0;
+
+    // ---- The first run builds the metadata and writes them.
+    {
+        Result r = run(argc, argv, disk(no_cap), remove_dir, [&] (Result const& rr) {
+            full_size = file_size(cache_file());
+            AMREX_ALWAYS_ASSERT(full_size > 0);
+            AMREX_ALWAYS_ASSERT(rr.fb.nbuild > 0 && rr.cpc.nbuild > 0);
+        });
+        check_same(r, ref, "first run with comm_cache_dir");
+        AMREX_ALWAYS_ASSERT(r.fb.nload == 0 && r.cpc.nload == 0);
+    }
+
+    // ---- The second run reads all of them and writes nothing.
+    {
+        Result r = run(argc, argv, disk(no_cap), [] () {}, [&] (Result const&) {
+            AMREX_ALWAYS_ASSERT(file_size(cache_file()) == full_size);
+        });
+        check_same(r, ref, "second run with comm_cache_dir");
+        AMREX_ALWAYS_ASSERT(r.fb.nload == r.fb.nbuild && r.cpc.nload == r.cpc.nbuild);
+    }
+
+    // ---- A damaged layout in the first record and a truncated last
+    // ---- record are rebuilt.  A record is magic, key and size, followed
+    // ---- by the size of the layout and the layout.
+    {
+        Result r = run(argc, argv, disk(no_cap), [&] () {
+            write_bytes(cache_file(), 4*sizeof(std::uint64_t), "X");
+            truncate_file(cache_file(), full_size - 8);
+        });
+        check_same(r, ref, "run with a damaged comm_cache_dir");
+        const Long nload = r.fb.nload + r.cpc.nload;
+        const Long nbuild = r.fb.nbuild + r.cpc.nbuild;
+        AMREX_ALWAYS_ASSERT(nload > 0 && nload <= nbuild - 2);
+    }
+
+    // ---- The rebuilt records are found by the next run.
+    {
+        Result r = run(argc, argv, disk(no_cap));
+        check_same(r, ref, "run after a damaged comm_cache_dir");
+        AMREX_ALWAYS_ASSERT(r.fb.nload == r.fb.nbuild && r.cpc.nload == r.cpc.nbuild);
+    }
+
+    // ---- Without a valid first record, nothing is found and the file is
+    // ---- started over.
+    {
+        Result r = run(argc, argv, disk(no_cap), [] () {
+            write_bytes(cache_file(), 0, std::string(sizeof(std::uint64_t), '\0'));
+        }, [&] (Result const&) {
+            AMREX_ALWAYS_ASSERT(file_size(cache_file()) == full_size);
+        });
+        check_same(r, ref, "run with a bad magic number");
+        AMREX_ALWAYS_ASSERT(r.fb.nload == 0 && r.cpc.nload == 0);
+    }
+
+    // ---- A file that would grow beyond the cap is started over.  The
+    // ---- cap is below the size of all records, so each process starts
+    // ---- over at least once.
+    {
+        const Long max_file_bytes = full_size / 2;
+        Result r = run(argc, argv, disk(max_file_bytes), [] () {
+            FileSystem::Remove(cache_file());
+        }, [&] (Result const&) {
+            const Long size = file_size(cache_file());
+            AMREX_ALWAYS_ASSERT(size > 0 && size <= max_file_bytes);
+        });
+        check_same(r, ref, "run with comm_cache_max_file_bytes");
+        AMREX_ALWAYS_ASSERT(r.fb.nload == 0 && r.cpc.nload == 0);
+    }
+
+    // ---- Clean up.
+    run(argc, argv, no_params, remove_dir);
+
+#ifdef AMREX_USE_MPI
+    MPI_Finalize();
+#endif
+}
@@ -0,0 +1,143 @@
+#include <AMReX.H>
+#include <AMReX_EB2.H>
+#include <AMReX_EB_STL_utils.H>
+#include <AMReX_EBFabFactory.H>
+#include <AMReX_ParmParse.H>
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+
+using namespace amrex;
+
+namespace {
+
+// Write a tessellated sphere as a binary STL file.
+void write_sphere_stl (std::string const& fname, int ntheta, Real radius, Real const* center)
+{
+    const int nphi = 2*ntheta;
+    const auto ntri = static_cast<std::uint32_t>(2*ntheta*nphi);
+
+    std::ofstream ofs(fname, std::ios::binary);
+    char header[80] = {};
+    ofs.write(header, 80);
+    ofs.write(reinterpret_cast<char const*>(&ntri), sizeof(ntri));
+
+    auto vertex = [&] (int it, int ip, float* v)
+    {
+        const double theta = M_PI * double(it) / double(ntheta);
+        const double phi   = 2.0 * M_PI * double(ip) / double(nphi);
+        v[0] = static_cast<float>(center[0] + radius*std::sin(theta)*std::cos(phi));
+        v[1] = static_cast<float>(center[1] + radius*std::sin(theta)*std::sin(phi));
+        v[2] = static_cast<float>(center[2] + radius*std::cos(theta));
+    };
+
+    auto write_tri = [&] (int it1, int ip1, int it2, int ip2, int it3, int ip3)
+    {
+        float buf[12] = {}; // normal and 3 vertices
+        vertex(it1, ip1, buf+3);
+        vertex(it2, ip2, buf+6);
+        vertex(it3, ip3, buf+9);
+        const std::uint16_t attr = 0;
+        ofs.write(reinterpret_cast<char const*>(buf), sizeof(buf));
+        ofs.write(reinterpret_cast<char const*>(&attr), sizeof(attr));
+    };
+
+    // Vertices are ordered so that the normals point outward.  The
+    // triangles at the poles are degenerate, which is harmless.
+    for (int it = 0; it < ntheta; ++it) {
+        for (int ip = 0; ip < nphi; ++ip) {
+            write_tri(it, ip, it+1, ip, it+1, ip+1);
+            write_tri(it, ip, it+1, ip+1, it, ip+1);
+        }
+    }
+}
+
+}
+
+int main (int argc, char* argv[])
+{
+    amrex::Initialize(argc, argv);
+    {
+        BL_PROFILE("main");
+
+        int n_cell = 32;
+        int max_grid_size = 16;
+        int ntheta = 48;
+        Real radius = 0.3;
+        std::string stl_file("sphere.stl");
+        {
+            ParmParse pp;
+            pp.query("n_cell", n_cell);
+            pp.query("max_grid_size", max_grid_size);
+            pp.query("ntheta", ntheta);
+            pp.query("radius", radius);
+            pp.query("stl_file", stl_file);
+        }
+
+        Geometry geom(Box(IntVect(0), IntVect(n_cell-1)),
+                      RealBox({AMREX_D_DECL(0.,0.,0.)}, {AMREX_D_DECL(1.,1.,1.)}),
+                      CoordSys::cartesian, {AMREX_D_DECL(0,0,0)});
+        BoxArray ba(geom.Domain());
+        ba.maxSize(max_grid_size);
+        DistributionMapping dm(ba);
+
+        if (ParallelDescriptor::IOProcessor()) {
+            Real center[] = {0.5, 0.5, 0.5};
+            write_sphere_stl(stl_file, ntheta, radius, center);
+        }
+        ParallelDescriptor::Barrier();
+
+        ParmParse pp("eb2");
+        pp.add("geom_type", std::string("stl"));
+        pp.add("stl_file", stl_file);
+
+        // Signed distance (inside/outside) fill through STLtools directly
+        Array<Real,3> stl_center{0.,0.,0.};
+        Array<MultiFab,2> marker;
+        Array<MultiFab,2> volfrac;
+        Array<double,2> t_fill{};
+        Array<double,2> t_build{};
+        for (int use_bvh = 0; use_bvh < 2; ++use_bvh)
+        {
+            STLtools stl;
+            stl.setUseBVH(use_bvh);
+            stl.read_stl_file(stl_file, 1.0, stl_center, 0);
+
+            marker[use_bvh].define(ba, dm, 1, 0);
+            double t0 = amrex::second();
+            stl.fill(marker[use_bvh], IntVect(0), geom);
+            t_fill[use_bvh] = amrex::second() - t0;
+
+            pp.add("stl_use_bvh", use_bvh);
+            t0 = amrex::second();
+            EB2::Build(geom, 0, 0);
+            t_build[use_bvh] = amrex::second() - t0;
+
+            auto factory = makeEBFabFactory(geom, ba, dm, {1,1,1}, EBSupport::full);
+            volfrac[use_bvh].define(ba, dm, 1, 0);
+            MultiFab::Copy(volfrac[use_bvh], factory->getVolFrac(), 0, 0, 1, 0);
+            factory.reset();
+            EB2::IndexSpace::pop();
+        }
+
+        ParallelDescriptor::ReduceRealMax(t_fill.data(), 2);
+        ParallelDescriptor::ReduceRealMax(t_build.data(), 2);
+
+        MultiFab::Subtract(marker[0], marker[1], 0, 0, 1, 0);
+        MultiFab::Subtract(volfrac[0], volfrac[1], 0, 0, 1, 0);
+        Real marker_diff = marker[0].norminf(0);
+        Real volfrac_diff = volfrac[0].norminf(0);
+
+        amrex::Print() << "\n# of triangles: " << 2*ntheta*2*ntheta << "\n"
+                       << "STLtools::fill  brute force: " << t_fill[0]
+                       << ", BVH: " << t_fill[1] << "\n"
+                       << "EB2::Build      brute force: " << t_build[0]
+                       << ", BVH: " << t_build[1] << "\n"
+                       << "max differences in fill and volume fraction: "
+                       << marker_diff << " " << volfrac_diff << "\n";
+
+        AMREX_ALWAYS_ASSERT(marker_diff == 0._rt && volfrac_diff == 0._rt);
+    }
+    amrex::Finalize();
+}
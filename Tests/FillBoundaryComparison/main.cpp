@@ -1,10 +1,14 @@
 #include <AMReX_Utility.H>
 #include <AMReX_ParallelDescriptor.H>
 #include <AMReX_MultiFab.H>
+#include <AMReX_FillBoundaryGroup.H>
 #include <AMReX_ParmParse.H>
+#include <AMReX_CommProgress.H>
 
 #include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <functional>
 
 #ifdef AMREX_USE_OMP
 #include <omp.h>
@@ -125,41 +129,307 @@ main (int argc, char* argv[])
     }
 
     int nrounds = 1000;
+    bool node_shared = true;
+    bool persistent_comm = true;
+    bool neighbor_collective = true;
+    bool fill_boundary_group = true;
+    bool overlap = true;
     {
         ParmParse pp;
         pp.query("nrounds", nrounds);
+        pp.query("node_shared", node_shared);
+        pp.query("persistent_comm", persistent_comm);
+        pp.query("neighbor_collective", neighbor_collective);
+        pp.query("fill_boundary_group", fill_boundary_group);
+        pp.query("overlap", overlap);
     }
 
-    Real err = 0.0;
+    // fill_all fills the ghost cells of all levels twice.
+    auto time_fill = [&] (std::function<void()> const& fill_all, std::string const& name)
+    {
+        Real err = 0.0;
 
-    ParallelDescriptor::Barrier();
-    auto wt0 = ParallelDescriptor::second();
+        ParallelDescriptor::Barrier();
+        auto wt0 = ParallelDescriptor::second();
+
+        for (int iround = 0; iround < nrounds; ++iround) {
+            for (int c=0; c<2; ++c) {
+                fill_all();
+            }
+            Real e = double(iround+ParallelDescriptor::MyProc());
+            ParallelDescriptor::ReduceRealMax(e);
+            err += e;
+        }
+
+        ParallelDescriptor::Barrier();
+        auto wt1 = ParallelDescriptor::second();
 
-    for (int iround = 0; iround < nrounds; ++iround) {
-        for (int c=0; c<2; ++c) {
+        if (ParallelDescriptor::IOProcessor()) {
+            std::cout << "Using " << name << std::endl;
+            std::cout << "----------------------------------------------" << std::endl;
+            std::cout << "Fill Boundary Time: " << wt1-wt0 << std::endl;
+            std::cout << "----------------------------------------------" << std::endl;
+            std::cout << "ignore this line " << err << std::endl;
+        }
+    };
+
+    auto time_fb = [&] (Vector<std::unique_ptr<MultiFab> >& a_mfs, std::string const& name)
+    {
+        time_fill([&] () {
             for (int lev = 0; lev < nlevels; ++lev) {
-                mfs[lev]->FillBoundary_nowait();
-                mfs[lev]->FillBoundary_finish();
+                a_mfs[lev]->FillBoundary_nowait();
+                a_mfs[lev]->FillBoundary_finish();
             }
             for (int lev = nlevels-1; lev >= 0; --lev) {
-                mfs[lev]->FillBoundary_nowait();
-                mfs[lev]->FillBoundary_finish();
+                a_mfs[lev]->FillBoundary_nowait();
+                a_mfs[lev]->FillBoundary_finish();
             }
+        }, name);
+    };
+
+    auto init_data = [] (MultiFab& mf)
+    {
+        mf.setVal(-1.0);
+        for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
+            const Box& bx = mfi.validbox();
+            auto const& a = mf.array(mfi);
+            amrex::LoopOnCpu(bx, [=] (int i, int j, int k)
+            {
+                a(i,j,k) = Real(i) + Real(j)*1.e3 + Real(k)*1.e6;
+            });
         }
-        Real e = double(iround+ParallelDescriptor::MyProc());
-        ParallelDescriptor::ReduceRealMax(e);
-        err += e;
+    };
+
+    // Check the results of FillBoundary on a_mfs against the ordinary
+    // FillBoundary on mfs.  It is done twice so that cached data are reused.
+    // use_comm(true) switches to the transport being tested, and
+    // use_comm(false) switches back.
+    auto check_fb = [&] (Vector<std::unique_ptr<MultiFab> >& a_mfs, std::string const& name,
+                         std::function<void(bool)> const& use_comm)
+    {
+        for (int lev=0; lev<nlevels; ++lev) {
+            MultiFab& mf = *mfs[lev];
+            MultiFab& amf = *a_mfs[lev];
+            for (int i = 0; i < 2; ++i) {
+                init_data(mf);
+                init_data(amf);
+                mf.FillBoundary();
+                use_comm(true);
+                amf.FillBoundary();
+                use_comm(false);
+                MultiFab::Subtract(amf, mf, 0, 0, 1, 1);
+                Real diff = amf.norm0(0, 1);
+                if (diff != 0.0) {
+                    amrex::Abort("FillBoundary with " + name + " failed on level "
+                                 + std::to_string(lev));
+                }
+            }
+            mf.setVal(1.0);
+            amf.setVal(1.0);
+        }
+    };
+
+    // Check ParallelCopy to a different DistributionMapping, and
+    // SumBoundary, against the ordinary ones.
+    auto check_pc = [&] (std::string const& name, std::function<void(bool)> const& use_comm)
+    {
+        Vector<int> pmap = dm.ProcessorMap();
+        for (auto& p : pmap) {
+            p = (p+1) % ParallelDescriptor::NProcs();
+        }
+        DistributionMapping dm2(std::move(pmap));
+        MultiFab mf(bas[0], dm2, 1, 1);
+        MultiFab amf(bas[0], dm2, 1, 1);
+        for (int i = 0; i < 2; ++i) {
+            init_data(*mfs[0]);
+            mf.setVal(-2.0);
+            amf.setVal(-2.0);
+            mf.ParallelCopy(*mfs[0], 0, 0, 1, 1, 1);
+            use_comm(true);
+            amf.ParallelCopy(*mfs[0], 0, 0, 1, 1, 1);
+            use_comm(false);
+            MultiFab::Subtract(amf, mf, 0, 0, 1, 1);
+            if (amf.norm0(0, 1) != 0.0) {
+                amrex::Abort("ParallelCopy with " + name + " failed");
+            }
+
+            init_data(mf);
+            init_data(amf);
+            mf.SumBoundary();
+            use_comm(true);
+            amf.SumBoundary();
+            use_comm(false);
+            MultiFab::Subtract(amf, mf, 0, 0, 1, 0);
+            if (amf.norm0(0, 0) != 0.0) {
+                amrex::Abort("SumBoundary with " + name + " failed");
+            }
+        }
+        mfs[0]->setVal(1.0);
+    };
+
+    FabArrayBase::persistent_comm = false;
+    time_fb(mfs, "MPI");
+
+    //
+    // The same with persistent requests.
+    //
+    if (persistent_comm)
+    {
+        Vector<std::unique_ptr<MultiFab> > pmfs(nlevels);
+        for (int lev=0; lev<nlevels; ++lev) {
+            pmfs[lev] = std::make_unique<MultiFab>(bas[lev], dm, 1, 1);
+        }
+
+        auto use_persistent = [] (bool on) { FabArrayBase::persistent_comm = on; };
+        check_fb(pmfs, "persistent requests", use_persistent);
+        check_pc("persistent requests", use_persistent);
+
+        FabArrayBase::persistent_comm = true;
+        time_fb(pmfs, "MPI with persistent requests");
+        FabArrayBase::persistent_comm = false;
+
+        pmfs.clear();
     }
 
-    ParallelDescriptor::Barrier();
-    auto wt1 = ParallelDescriptor::second();
-
-    if (ParallelDescriptor::IOProcessor()) {
-        std::cout << "Using MPI" << std::endl;
-        std::cout << "----------------------------------------------" << std::endl;
-        std::cout << "Fill Boundary Time: " << wt1-wt0 << std::endl;
-        std::cout << "----------------------------------------------" << std::endl;
-        std::cout << "ignore this line " << err << std::endl;
+    //
+    // The same with neighborhood collectives.
+    //
+    if (neighbor_collective)
+    {
+        Vector<std::unique_ptr<MultiFab> > nmfs(nlevels);
+        for (int lev=0; lev<nlevels; ++lev) {
+            nmfs[lev] = std::make_unique<MultiFab>(bas[lev], dm, 1, 1);
+        }
+
+        auto use_neighbor = [] (bool on) { FabArrayBase::neighbor_collective = on; };
+        check_fb(nmfs, "neighborhood collectives", use_neighbor);
+        check_pc("neighborhood collectives", use_neighbor);
+
+        FabArrayBase::neighbor_collective = true;
+        time_fb(nmfs, "MPI neighborhood collectives");
+        FabArrayBase::neighbor_collective = false;
+
+        nmfs.clear();
+    }
+
+    //
+    // The same with all the levels in one FillBoundaryGroup, so that there
+    // is only one message per pair of processes.  The MultiFabs have more
+    // components and ghost cells than are filled.
+    //
+    if (fill_boundary_group)
+    {
+        Vector<std::unique_ptr<MultiFab> > gmfs(nlevels);
+        FillBoundaryGroup<MultiFab> group;
+        for (int lev=0; lev<nlevels; ++lev) {
+            gmfs[lev] = std::make_unique<MultiFab>(bas[lev], dm, 2, 2);
+            group.add(*gmfs[lev], 0, 1, IntVect(1));
+        }
+
+        for (int i = 0; i < 2; ++i) {
+            for (int lev=0; lev<nlevels; ++lev) {
+                init_data(*mfs[lev]);
+                init_data(*gmfs[lev]);
+                mfs[lev]->FillBoundary();
+            }
+            group.FillBoundary();
+            for (int lev=0; lev<nlevels; ++lev) {
+                MultiFab::Subtract(*gmfs[lev], *mfs[lev], 0, 0, 1, 1);
+                if (gmfs[lev]->norm0(0, 1) != 0.0) {
+                    amrex::Abort("FillBoundaryGroup failed on level " + std::to_string(lev));
+                }
+                mfs[lev]->setVal(1.0);
+            }
+        }
+
+        time_fill([&] () {
+            group.FillBoundary();
+            group.FillBoundary();
+        }, "MPI with FillBoundaryGroup");
+    }
+
+    //
+    // Overlap FillBoundary with computation on other data.  Run with
+    // amrex.comm_progress_thread=1 to let a background thread progress
+    // the messages during the computation.
+    //
+    if (overlap)
+    {
+        MultiFab work(bas[0], dm, 1, 0);
+        work.setVal(1.0);
+        auto compute = [&] () {
+            for (MFIter mfi(work); mfi.isValid(); ++mfi) {
+                auto const& a = work.array(mfi);
+                amrex::LoopOnCpu(mfi.validbox(), [=] (int i, int j, int k)
+                {
+                    for (int n = 0; n < 8; ++n) {
+                        a(i,j,k) = std::sqrt(a(i,j,k)*a(i,j,k) + Real(1.e-3));
+                    }
+                });
+            }
+        };
+        auto fill_overlap = [&] (Vector<std::unique_ptr<MultiFab> >& a_mfs) {
+            for (int lev = 0; lev < nlevels; ++lev) {
+                a_mfs[lev]->FillBoundary_nowait();
+            }
+            compute();
+            for (int lev = 0; lev < nlevels; ++lev) {
+                a_mfs[lev]->FillBoundary_finish();
+            }
+        };
+
+        Vector<std::unique_ptr<MultiFab> > omfs(nlevels);
+        for (int lev=0; lev<nlevels; ++lev) {
+            omfs[lev] = std::make_unique<MultiFab>(bas[lev], dm, 1, 1);
+            init_data(*mfs[lev]);
+            init_data(*omfs[lev]);
+            mfs[lev]->FillBoundary();
+        }
+        fill_overlap(omfs);
+        for (int lev=0; lev<nlevels; ++lev) {
+            MultiFab::Subtract(*omfs[lev], *mfs[lev], 0, 0, 1, 1);
+            if (omfs[lev]->norm0(0, 1) != 0.0) {
+                amrex::Abort("FillBoundary overlapped with computation failed on level "
+                             + std::to_string(lev));
+            }
+            mfs[lev]->setVal(1.0);
+        }
+
+        std::string progress = CommProgress::Active() ? " and progress thread" : "";
+        time_fill([&] () {
+            for (int lev = 0; lev < nlevels; ++lev) {
+                mfs[lev]->FillBoundary();
+            }
+            compute();
+        }, "MPI followed by computation" + progress);
+        time_fill([&] () { fill_overlap(mfs); },
+                  "MPI overlapped with computation" + progress);
+    }
+
+    //
+    // The same with the data in memory shared by the processes on a node.
+    //
+    if (node_shared)
+    {
+        Vector<std::unique_ptr<MultiFab> > shmfs(nlevels);
+        for (int lev=0; lev<nlevels; ++lev) {
+            shmfs[lev] = std::make_unique<MultiFab>(bas[lev], dm, 1, 1,
+                                                    MFInfo().SetNodeShared(true));
+        }
+        if (ParallelDescriptor::IOProcessor()) {
+            std::cout << "Node shared memory: "
+                      << (shmfs[0]->NodeSharedMemory() ? "yes" : "no") << std::endl;
+        }
+
+        check_fb(shmfs, "node shared memory",
+                 [&] (bool on) { FabArrayBase::persistent_comm = on && persistent_comm; });
+
+        FabArrayBase::persistent_comm = persistent_comm;
+        time_fb(shmfs, persistent_comm ? "MPI with node shared memory and persistent requests"
+                                       : "MPI with node shared memory");
+        FabArrayBase::persistent_comm = false;
+
+        shmfs.clear();
     }
 
     //
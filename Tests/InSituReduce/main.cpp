@@ -0,0 +1,144 @@
+#include <AMReX.H>
+#include <AMReX_InSituReduce.H>
+#include <AMReX_MultiFab.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_Print.H>
+#include <AMReX_Utility.H>
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace amrex;
+
+namespace {
+
+// The records of a text file written by a reducer, without comments and blank lines.
+Vector<Vector<std::string>> read_records (std::string const& file)
+{
+    Vector<Vector<std::string>> records;
+    std::ifstream ifs(file);
+    AMREX_ALWAYS_ASSERT(ifs.good());
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.empty() || line[0] == '#') { continue; }
+        std::istringstream iss(line);
+        Vector<std::string> words;
+        std::string w;
+        while (iss >> w) { words.push_back(w); }
+        records.push_back(words);
+    }
+    return records;
+}
+
+bool close (std::string const& a, Real b)
+{
+    return std::abs(std::stod(a) - b) < 1.e-10;
+}
+
+}
+
+int main (int argc, char* argv[])
+{
+    amrex::Initialize(argc,argv);
+    {
+        int n_cell = 32;
+        int max_grid_size = 16;
+        {
+            ParmParse pp;
+            pp.query("n_cell", n_cell);
+            pp.query("max_grid_size", max_grid_size);
+        }
+
+        if (ParallelDescriptor::IOProcessor()) {
+            for (auto const* f : {"vsum.dat", "havg.dat", "ext.dat", "hist.dat"}) {
+                std::remove(f);
+            }
+        }
+        ParallelDescriptor::Barrier();
+
+        // ---- level 1 covers the middle half of the domain
+        const int nlevels = 2;
+        const IntVect ratio(2);
+        RealBox rb({AMREX_D_DECL(0.,0.,0.)}, {AMREX_D_DECL(1.,1.,1.)});
+        Vector<Geometry> geom(nlevels);
+        Vector<BoxArray> ba(nlevels);
+        Box domain(IntVect(0), IntVect(n_cell-1));
+        geom[0].define(domain, rb, 0, {AMREX_D_DECL(0,0,0)});
+        geom[1].define(amrex::refine(domain, ratio), rb, 0, {AMREX_D_DECL(0,0,0)});
+        ba[0] = BoxArray(domain);
+        ba[1] = BoxArray(amrex::refine(Box(IntVect(n_cell/4), IntVect(3*n_cell/4-1)), ratio));
+
+        // ---- "h" is the coordinate in the last direction, "one" is 1
+        const Vector<std::string> varnames{"one", "h"};
+        Vector<MultiFab> mf(nlevels);
+        for (int lev = 0; lev < nlevels; ++lev) {
+            ba[lev].maxSize(max_grid_size);
+            mf[lev].define(ba[lev], DistributionMapping(ba[lev]), 2, 0);
+            const Real dx = geom[lev].CellSize(AMREX_SPACEDIM-1);
+            auto const& ma = mf[lev].arrays();
+            ParallelFor(mf[lev], [=] AMREX_GPU_DEVICE (int b, int i, int j, int k)
+            {
+                IntVect iv(AMREX_D_DECL(i,j,k));
+                ma[b](i,j,k,0) = 1.0_rt;
+                ma[b](i,j,k,1) = (iv[AMREX_SPACEDIM-1] + 0.5_rt) * dx;
+            });
+        }
+        Gpu::streamSynchronize();
+
+        const Vector<MultiFab const*> pmf{&mf[0], &mf[1]};
+        const Vector<IntVect> ref_ratio{ratio};
+        for (int step = 0; step < 2; ++step) {
+            const Real time = 0.5_rt * step;
+            InSituReduce::Reduce(nlevels, pmf, varnames, geom, time, step, ref_ratio);
+
+            InSituData data;
+            data.nlevels = nlevels;
+            data.mf = pmf;
+            data.varnames = varnames;
+            data.geom = geom;
+            data.ref_ratio = ref_ratio;
+            data.time = time;
+            data.step = step;
+            InSituReduce::Reduce(InSituReduce::ScheduledReducers(step), data);
+        }
+
+        if (ParallelDescriptor::IOProcessor()) {
+            auto vsum = read_records("vsum.dat");
+            AMREX_ALWAYS_ASSERT(vsum.size() == 2);
+            AMREX_ALWAYS_ASSERT(close(vsum[1][0], 1) && close(vsum[1][1], 0.5));
+            AMREX_ALWAYS_ASSERT(close(vsum[1][2], 1) && close(vsum[1][3], 0.5));
+
+            // ---- one block of 2*n_cell bins at the fine resolution per step.
+            // Level 1 covers a fraction of the planes in the middle half;
+            // elsewhere the bins get the value of the coarse cell.
+            auto havg = read_records("havg.dat");
+            AMREX_ALWAYS_ASSERT(havg.size() == 4*n_cell);
+            const Real ffine = std::pow(0.5_rt, AMREX_SPACEDIM-1);
+            for (int ib = 0; ib < 4*n_cell; ++ib) {
+                auto const& r = havg[ib];
+                const int jb = ib % (2*n_cell);
+                const Real hf = std::stod(r[0]);
+                const Real hc = (jb/2 + 0.5_rt) / n_cell;
+                const Real h = (jb >= n_cell/2 && jb < 3*n_cell/2)
+                    ? ffine*hf + (1.0_rt-ffine)*hc : hc;
+                AMREX_ALWAYS_ASSERT(close(r[1], h) && close(r[2], 1));
+            }
+
+            auto ext = read_records("ext.dat");
+            AMREX_ALWAYS_ASSERT(ext.size() == 2);
+            AMREX_ALWAYS_ASSERT(close(ext[0][2], 0.5/n_cell) && close(ext[0][3], 1-0.5/n_cell));
+
+            auto hist = read_records("hist.dat");
+            AMREX_ALWAYS_ASSERT(hist.size() == 2 && hist[0].size() == 9);
+            AMREX_ALWAYS_ASSERT(close(hist[0][6], 0) && close(hist[0][7], 1));
+
+            AMREX_ALWAYS_ASSERT(amrex::FileExists("slc_00001/Header"));
+        }
+
+        amrex::Print() << "InSituReduce test passed\n";
+    }
+    amrex::Finalize();
+}
@@ -1,5 +1,6 @@
 #include "MyTest.H"
 
+#include <AMReX_MLMGMixed.H>
 #include <AMReX_ParmParse.H>
 
 using namespace amrex;
@@ -13,7 +14,9 @@ MyTest::MyTest ()
 void
 MyTest::solve ()
 {
-    if (prob_type == 1) {
+    if (mixed_precision) {
+        solveMixedPrecision();
+    } else if (prob_type == 1) {
         if (single_precision) {
             solvePoisson<fMultiFab>();
         } else {
@@ -30,6 +33,117 @@ MyTest::solve ()
     }
 }
 
+void
+MyTest::solveMixedPrecision ()
+{
+    LPInfo info;
+    info.setAgglomeration(agglomeration);
+    info.setConsolidation(consolidation);
+    info.setMaxCoarseningLevel(max_coarsening_level);
+
+    const Real tol_rel = 1.e-10;
+    const Real tol_abs = 0.0;
+
+    const auto nlevels = int(geom.size());
+    const int nsolves = composite_solve ? 1 : nlevels;
+
+    for (int isolve = 0; isolve < nsolves; ++isolve)
+    {
+        const int lev0 = composite_solve ? 0 : isolve;
+        const int nlevs = composite_solve ? nlevels : 1;
+        Vector<Geometry> lgeom(geom.begin()+lev0, geom.begin()+lev0+nlevs);
+        Vector<BoxArray> lgrids(grids.begin()+lev0, grids.begin()+lev0+nlevs);
+        Vector<DistributionMapping> ldmap(dmap.begin()+lev0, dmap.begin()+lev0+nlevs);
+
+        // The double precision operator has the actual boundary conditions.
+        // The single precision one solves for corrections, so its boundary
+        // conditions are homogeneous.
+        auto setup = [&] (auto& linop, bool homogeneous)
+        {
+            linop.setMaxOrder(linop_maxorder);
+
+            // This is a problem with Dirichlet BC
+            linop.setDomainBC({AMREX_D_DECL(LinOpBCType::Dirichlet,
+                                            LinOpBCType::Dirichlet,
+                                            LinOpBCType::Dirichlet)},
+                              {AMREX_D_DECL(LinOpBCType::Dirichlet,
+                                            LinOpBCType::Dirichlet,
+                                            LinOpBCType::Dirichlet)});
+
+            if (lev0 > 0) {
+                if (homogeneous) {
+                    linop.setCoarseFineBC(nullptr, ref_ratio);
+                } else {
+                    linop.setCoarseFineBC(&solution[lev0-1], ref_ratio);
+                }
+            }
+
+            for (int ilev = 0; ilev < nlevs; ++ilev) {
+                if (homogeneous) {
+                    linop.setLevelBC(ilev, nullptr);
+                } else {
+                    linop.setLevelBC(ilev, &solution[lev0+ilev]);
+                }
+            }
+
+            using LinOp = std::decay_t<decltype(linop)>;
+            if constexpr (std::is_same_v<LinOp,MLABecLaplacian> ||
+                          std::is_same_v<LinOp,MLABecLaplacianT<fMultiFab>>) {
+                linop.setScalars(ascalar, bscalar);
+                for (int ilev = 0; ilev < nlevs; ++ilev)
+                {
+                    linop.setACoeffs(ilev, acoef[lev0+ilev]);
+
+                    Array<MultiFab,AMREX_SPACEDIM> face_bcoef;
+                    for (int idim = 0; idim < AMREX_SPACEDIM; ++idim)
+                    {
+                        const BoxArray& ba = amrex::convert(bcoef[lev0+ilev].boxArray(),
+                                                            IntVect::TheDimensionVector(idim));
+                        face_bcoef[idim].define(ba, bcoef[lev0+ilev].DistributionMap(), 1, 0);
+                    }
+                    amrex::average_cellcenter_to_face(GetArrOfPtrs(face_bcoef),
+                                                      bcoef[lev0+ilev], geom[lev0+ilev]);
+                    linop.setBCoeffs(ilev, amrex::GetArrOfConstPtrs(face_bcoef));
+                }
+            }
+        };
+
+        auto run = [&] (auto& linop, auto& linop_lo)
+        {
+            setup(linop, false);
+            setup(linop_lo, true);
+
+            MLMG mlmg(linop);
+
+            MLMGT<fMultiFab> mlmg_lo(linop_lo);
+            mlmg_lo.setMaxIter(max_iter);
+            mlmg_lo.setMaxFmgIter(max_fmg_iter);
+            mlmg_lo.setVerbose(verbose-1);
+            mlmg_lo.setBottomVerbose(bottom_verbose);
+
+            MLMGMixed mlmg_mixed(mlmg, mlmg_lo);
+            mlmg_mixed.setVerbose(verbose);
+            Vector<MultiFab*> psol;
+            Vector<MultiFab const*> prhs;
+            for (int ilev = lev0; ilev < lev0+nlevs; ++ilev) {
+                psol.push_back(&solution[ilev]);
+                prhs.push_back(&rhs[ilev]);
+            }
+            mlmg_mixed.solve(psol, prhs, tol_rel, tol_abs);
+        };
+
+        if (prob_type == 1) {
+            MLPoisson linop(lgeom, lgrids, ldmap, info);
+            MLPoissonT<fMultiFab> linop_lo(lgeom, lgrids, ldmap, info);
+            run(linop, linop_lo);
+        } else {
+            MLABecLaplacian linop(lgeom, lgrids, ldmap, info);
+            MLABecLaplacianT<fMultiFab> linop_lo(lgeom, lgrids, ldmap, info);
+            run(linop, linop_lo);
+        }
+    }
+}
+
 void
 MyTest::readParameters ()
 {
@@ -44,6 +158,7 @@ MyTest::readParameters ()
     pp.query("prob_type", prob_type);
 
     pp.query("single_precision", single_precision);
+    pp.query("mixed_precision", mixed_precision);
 
     pp.query("verbose", verbose);
     pp.query("bottom_verbose", bottom_verbose);
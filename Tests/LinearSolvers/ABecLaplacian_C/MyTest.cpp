@@ -2,6 +2,7 @@
 
 #include <AMReX_MLABecLaplacian.H>
 #include <AMReX_MLPoisson.H>
+#include <AMReX_MLMGKrylov.H>
 #include <AMReX_ParmParse.H>
 #include <AMReX_MultiFabUtil.H>
 
@@ -47,6 +48,8 @@ MyTest::solvePoisson ()
 
         mlpoisson.setMaxOrder(linop_maxorder);
 
+        mlpoisson.setSmoother(smoother);
+
         // This is a 3d problem with Dirichlet BC
         mlpoisson.setDomainBC({AMREX_D_DECL(LinOpBCType::Dirichlet,
                                             LinOpBCType::Dirichlet,
@@ -65,6 +68,7 @@ MyTest::solvePoisson ()
         mlmg.setMaxFmgIter(max_fmg_iter);
         mlmg.setVerbose(verbose);
         mlmg.setBottomVerbose(bottom_verbose);
+        mlmg.setBottomSolver(bottom_solver);
 #ifdef AMREX_USE_HYPRE
         if (use_hypre) {
             mlmg.setBottomSolver(MLMG::BottomSolver::hypre);
@@ -78,6 +82,13 @@ MyTest::solvePoisson ()
 #endif
 
         mlmg.solve(GetVecOfPtrs(solution), GetVecOfConstPtrs(rhs), tol_rel, tol_abs);
+
+        if (bottom_solver == BottomSolver::amg) {
+            // The bottom level of inputs-rt-amg is larger than the AMG
+            // coarse size, so the AMG must have coarsened it.
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(mlmg.getAMGNumLevels() > 1,
+                                             "AMG bottom solver did not coarsen");
+        }
     }
     else
     {
@@ -87,6 +98,8 @@ MyTest::solvePoisson ()
 
             mlpoisson.setMaxOrder(linop_maxorder);
 
+            mlpoisson.setSmoother(smoother);
+
             // This is a 3d problem with Dirichlet BC
             mlpoisson.setDomainBC({AMREX_D_DECL(LinOpBCType::Dirichlet,
                                                 LinOpBCType::Dirichlet,
@@ -106,6 +119,7 @@ MyTest::solvePoisson ()
             mlmg.setMaxFmgIter(max_fmg_iter);
             mlmg.setVerbose(verbose);
             mlmg.setBottomVerbose(bottom_verbose);
+            mlmg.setBottomSolver(bottom_solver);
 #ifdef AMREX_USE_HYPRE
             if (use_hypre) {
                 mlmg.setBottomSolver(MLMG::BottomSolver::hypre);
@@ -118,7 +132,15 @@ MyTest::solvePoisson ()
             }
 #endif
 
-            mlmg.solve({&solution[ilev]}, {&rhs[ilev]}, tol_rel, tol_abs);
+            if (krylov > 0) {
+                MLMGKrylov mlmg_krylov(mlmg, (krylov == 1) ? MLMGKrylov::Type::FGMRES
+                                                           : MLMGKrylov::Type::PCG);
+                mlmg_krylov.setVerbose(verbose);
+                mlmg_krylov.setMaxIter(max_iter);
+                mlmg_krylov.solve(solution[ilev], rhs[ilev], tol_rel, tol_abs);
+            } else {
+                mlmg.solve({&solution[ilev]}, {&rhs[ilev]}, tol_rel, tol_abs);
+            }
         }
     }
 }
@@ -145,6 +167,8 @@ MyTest::solveABecLaplacian ()
 
         mlabec.setMaxOrder(linop_maxorder);
 
+        mlabec.setSmoother(smoother);
+
         // This is a 3d problem with homogeneous Neumann BC
         mlabec.setDomainBC({AMREX_D_DECL(LinOpBCType::Neumann,
                                          LinOpBCType::Neumann,
@@ -182,6 +206,7 @@ MyTest::solveABecLaplacian ()
         mlmg.setMaxFmgIter(max_fmg_iter);
         mlmg.setVerbose(verbose);
         mlmg.setBottomVerbose(bottom_verbose);
+        mlmg.setBottomSolver(bottom_solver);
 #ifdef AMREX_USE_HYPRE
         if (use_hypre) {
             mlmg.setBottomSolver(MLMG::BottomSolver::hypre);
@@ -195,6 +220,13 @@ MyTest::solveABecLaplacian ()
 #endif
 
         mlmg.solve(GetVecOfPtrs(solution), GetVecOfConstPtrs(rhs), tol_rel, tol_abs);
+
+        if (bottom_solver == BottomSolver::amg) {
+            // The bottom level of inputs-rt-amg is larger than the AMG
+            // coarse size, so the AMG must have coarsened it.
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(mlmg.getAMGNumLevels() > 1,
+                                             "AMG bottom solver did not coarsen");
+        }
     }
     else
     {
@@ -204,6 +236,8 @@ MyTest::solveABecLaplacian ()
 
             mlabec.setMaxOrder(linop_maxorder);
 
+            mlabec.setSmoother(smoother);
+
             // This is a 3d problem with homogeneous Neumann BC
             mlabec.setDomainBC({AMREX_D_DECL(LinOpBCType::Neumann,
                                              LinOpBCType::Neumann,
@@ -239,6 +273,7 @@ MyTest::solveABecLaplacian ()
             mlmg.setMaxFmgIter(max_fmg_iter);
             mlmg.setVerbose(verbose);
             mlmg.setBottomVerbose(bottom_verbose);
+            mlmg.setBottomSolver(bottom_solver);
 #ifdef AMREX_USE_HYPRE
             if (use_hypre) {
                 mlmg.setBottomSolver(MLMG::BottomSolver::hypre);
@@ -251,7 +286,15 @@ MyTest::solveABecLaplacian ()
             }
 #endif
 
-            mlmg.solve({&solution[ilev]}, {&rhs[ilev]}, tol_rel, tol_abs);
+            if (krylov > 0) {
+                MLMGKrylov mlmg_krylov(mlmg, (krylov == 1) ? MLMGKrylov::Type::FGMRES
+                                                           : MLMGKrylov::Type::PCG);
+                mlmg_krylov.setVerbose(verbose);
+                mlmg_krylov.setMaxIter(max_iter);
+                mlmg_krylov.solve(solution[ilev], rhs[ilev], tol_rel, tol_abs);
+            } else {
+                mlmg.solve({&solution[ilev]}, {&rhs[ilev]}, tol_rel, tol_abs);
+            }
         }
     }
 
@@ -287,6 +330,8 @@ MyTest::solveABecLaplacianInhomNeumann ()
 
         mlabec.setMaxOrder(linop_maxorder);
 
+        mlabec.setSmoother(smoother);
+
         // This is a 3d problem with inhomogeneous Neumann BC
         mlabec.setDomainBC({AMREX_D_DECL(LinOpBCType::inhomogNeumann,
                                          LinOpBCType::inhomogNeumann,
@@ -324,6 +369,7 @@ MyTest::solveABecLaplacianInhomNeumann ()
         mlmg.setMaxFmgIter(max_fmg_iter);
         mlmg.setVerbose(verbose);
         mlmg.setBottomVerbose(bottom_verbose);
+        mlmg.setBottomSolver(bottom_solver);
 #ifdef AMREX_USE_HYPRE
         if (use_hypre) {
             mlmg.setBottomSolver(MLMG::BottomSolver::hypre);
@@ -337,6 +383,13 @@ MyTest::solveABecLaplacianInhomNeumann ()
 #endif
 
         mlmg.solve(GetVecOfPtrs(solution), GetVecOfConstPtrs(rhs), tol_rel, tol_abs);
+
+        if (bottom_solver == BottomSolver::amg) {
+            // The bottom level of inputs-rt-amg is larger than the AMG
+            // coarse size, so the AMG must have coarsened it.
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(mlmg.getAMGNumLevels() > 1,
+                                             "AMG bottom solver did not coarsen");
+        }
     }
     else
     {
@@ -346,6 +399,8 @@ MyTest::solveABecLaplacianInhomNeumann ()
 
             mlabec.setMaxOrder(linop_maxorder);
 
+            mlabec.setSmoother(smoother);
+
             // This is a 3d problem with inhomogeneous Neumann BC
             mlabec.setDomainBC({AMREX_D_DECL(LinOpBCType::inhomogNeumann,
                                              LinOpBCType::inhomogNeumann,
@@ -381,6 +436,7 @@ MyTest::solveABecLaplacianInhomNeumann ()
             mlmg.setMaxFmgIter(max_fmg_iter);
             mlmg.setVerbose(verbose);
             mlmg.setBottomVerbose(bottom_verbose);
+            mlmg.setBottomSolver(bottom_solver);
 #ifdef AMREX_USE_HYPRE
             if (use_hypre) {
                 mlmg.setBottomSolver(MLMG::BottomSolver::hypre);
@@ -393,7 +449,15 @@ MyTest::solveABecLaplacianInhomNeumann ()
             }
 #endif
 
-            mlmg.solve({&solution[ilev]}, {&rhs[ilev]}, tol_rel, tol_abs);
+            if (krylov > 0) {
+                MLMGKrylov mlmg_krylov(mlmg, (krylov == 1) ? MLMGKrylov::Type::FGMRES
+                                                           : MLMGKrylov::Type::PCG);
+                mlmg_krylov.setVerbose(verbose);
+                mlmg_krylov.setMaxIter(max_iter);
+                mlmg_krylov.solve(solution[ilev], rhs[ilev], tol_rel, tol_abs);
+            } else {
+                mlmg.solve({&solution[ilev]}, {&rhs[ilev]}, tol_rel, tol_abs);
+            }
         }
     }
 
@@ -433,6 +497,44 @@ MyTest::readParameters ()
     pp.query("max_coarsening_level", max_coarsening_level);
     pp.query("max_semicoarsening_level", max_semicoarsening_level);
 
+    std::string bottom_solver_s;
+    pp.query("bottom_solver", bottom_solver_s);
+    if (bottom_solver_s == "smoother") {
+        bottom_solver = BottomSolver::smoother;
+    } else if (bottom_solver_s == "bicgstab") {
+        bottom_solver = BottomSolver::bicgstab;
+    } else if (bottom_solver_s == "cg") {
+        bottom_solver = BottomSolver::cg;
+    } else if (bottom_solver_s == "pipelinedbicgstab") {
+        bottom_solver = BottomSolver::pipelinedbicgstab;
+    } else if (bottom_solver_s == "pipelinedcg") {
+        bottom_solver = BottomSolver::pipelinedcg;
+    } else if (bottom_solver_s == "amg") {
+        bottom_solver = BottomSolver::amg;
+    } else if ( ! bottom_solver_s.empty()) {
+        amrex::Abort("Unknown bottom_solver " + bottom_solver_s);
+    }
+
+    std::string smoother_s;
+    pp.query("smoother", smoother_s);
+    if (smoother_s == "chebyshev") {
+        smoother = Smoother::chebyshev;
+    } else if (smoother_s == "l1jacobi") {
+        smoother = Smoother::l1jacobi;
+    } else if ( ! smoother_s.empty()) {
+        amrex::Abort("Unknown smoother " + smoother_s);
+    }
+
+    std::string krylov_s;
+    pp.query("krylov", krylov_s);
+    if (krylov_s == "fgmres") {
+        krylov = 1;
+    } else if (krylov_s == "pcg") {
+        krylov = 2;
+    } else if ( ! krylov_s.empty()) {
+        amrex::Abort("Unknown krylov " + krylov_s);
+    }
+
 #ifdef AMREX_USE_HYPRE
     pp.query("use_hypre", use_hypre);
     pp.query("hypre_interface", hypre_interface_i);
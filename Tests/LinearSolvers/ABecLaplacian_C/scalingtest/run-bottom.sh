@@ -0,0 +1,30 @@
+#!/bin/bash
+#BSUB -P CSC308
+#BSUB -W 0:30
+#BSUB -nnodes 64
+#BSUB -J amrex
+#BSUB -o amrexo.%J
+#BSUB -e amrexe.%J
+module load gcc
+module load cuda
+module list
+set -x
+
+# Strong scaling of the Krylov bottom solvers: the same problem is solved
+# with each bottom solver.  Change -nnodes and NUMNODES (6 per node) to
+# run it on 8, 16, ..., 2048 nodes, and compare MLMG::actualBottomSolve()
+# in the TinyProfiler output.
+
+omp=1
+export PAMI_DISABLE_IPC=1
+export OMP_NUM_THREADS=${omp}
+
+EXE="./main3d.gnu.TPROF.MPI.CUDA.ex"
+SMPIARGS= --smpiargs="-x PAMI_DISABLE_CUDA_HOOK=1 -disable_gpu_hooks"
+
+NUMNODES=384
+NUMCELLS=512
+
+for BOTTOM in bicgstab pipelinedbicgstab cg pipelinedcg; do
+    jsrun -n ${NUMNODES} -a 1 -g 1 -c 1 --bind=packed:${omp} ${SMPIARGS} ${EXE} inputs.test n_cell=${NUMCELLS} verbose=0 max_fmg_iter=0 bottom_solver=${BOTTOM} > output_bottom_${BOTTOM}_${NUMNODES}_${LSB_JOBID}.txt
+done
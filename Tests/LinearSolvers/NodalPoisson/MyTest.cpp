@@ -28,6 +28,7 @@ MyTest::solve ()
     {
         MLNodeLaplacian linop(geom, grids, dmap, info);
         //linop.setSmoothNumSweeps(smooth_num_sweeps);
+        linop.setSmoother(smoother);
 
         linop.setDomainBC({AMREX_D_DECL(LinOpBCType::Dirichlet,
                                         LinOpBCType::Dirichlet,
@@ -45,6 +46,9 @@ MyTest::solve ()
         mlmg.setMaxFmgIter(max_fmg_iter);
         mlmg.setVerbose(verbose);
         mlmg.setBottomVerbose(bottom_verbose);
+        if (use_amg) {
+            mlmg.setBottomSolver(MLMG::BottomSolver::amg);
+        }
         // solution is passed to MLMG::solve to provide an initial guess.
         // Additionally it also provides boundary conditions for Dirichlet
         // boundaries if there are any.
@@ -59,12 +63,20 @@ MyTest::solve ()
         }
 
         mlmg.solve(GetVecOfPtrs(solution), GetVecOfConstPtrs(rhs), reltol, 0.0);
+
+        if (use_amg) {
+            // The bottom level of inputs-rt-amg is larger than the AMG
+            // coarse size, so the AMG must have coarsened it.
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(mlmg.getAMGNumLevels() > 1,
+                                             "AMG bottom solver did not coarsen");
+        }
     }
     else // solve level by level
     {
         for (int ilev = 0; ilev <= max_level; ++ilev)
         {
             MLNodeLaplacian linop({geom[ilev]}, {grids[ilev]}, {dmap[ilev]}, info);
+            linop.setSmoother(smoother);
 
             linop.setDomainBC({AMREX_D_DECL(LinOpBCType::Dirichlet,
                                             LinOpBCType::Dirichlet,
@@ -80,6 +92,9 @@ MyTest::solve ()
             mlmg.setMaxFmgIter(max_fmg_iter);
             mlmg.setVerbose(verbose);
             mlmg.setBottomVerbose(bottom_verbose);
+            if (use_amg) {
+                mlmg.setBottomSolver(MLMG::BottomSolver::amg);
+            }
 #ifdef AMREX_USE_HYPRE
             if (use_hypre) {
                 mlmg.setBottomSolver(MLMG::BottomSolver::hypre);
@@ -164,6 +179,18 @@ MyTest::readParameters ()
     pp.query("do_plots", do_plots);
     pp.query("num_trials", num_trials);
 
+    pp.query("use_amg", use_amg);
+
+    std::string smoother_s;
+    pp.query("smoother", smoother_s);
+    if (smoother_s == "chebyshev") {
+        smoother = Smoother::chebyshev;
+    } else if (smoother_s == "l1jacobi") {
+        smoother = Smoother::l1jacobi;
+    } else if ( ! smoother_s.empty()) {
+        amrex::Abort("Unknown smoother " + smoother_s);
+    }
+
 #ifdef AMREX_USE_HYPRE
     pp.query("use_hypre", use_hypre);
     pp.query("hypre_interface", hypre_interface_i);
@@ -1,6 +1,12 @@
 #include <AMReX.H>
 #include <AMReX_Parser.H>
 #include <AMReX_IParser.H>
+#include <AMReX_FArrayBox.H>
+#include <AMReX_IArrayBox.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_Utility.H>
+#include <cfenv>
+#include <cmath>
 #include <map>
 
 using namespace amrex;
@@ -23,6 +29,7 @@ int test1 (std::string const& f,
     }
     parser.registerVariables(variables);
     auto const exe = parser.compile<1>();
+    auto const exe_lowered = parser.compile<1>(true);
     max_stack_size = std::max(max_stack_size, parser.maxStackSize());
 
     GpuArray<Real,1> dx{(hi[0]-lo[0]) / (N-1)};
@@ -32,6 +39,12 @@ int test1 (std::string const& f,
     for (int i = 0; i < N; ++i) {
         Real x = lo[0] + i*dx[0];
         Real result = exe(x);
+        Real result_lowered = exe_lowered(x);
+        if (result_lowered != result && !(std::isnan(result_lowered) && std::isnan(result))) {
+            amrex::Print() << "\n    lowered f(" << x << ") = " << result_lowered << ", "
+                           << result;
+            ++nfail;
+        }
         Real benchmark = fb(x);
         Real abserror = std::abs(result-benchmark);
         Real relerror = abserror / (1.e-50 + std::max(std::abs(result),std::abs(benchmark)));
@@ -67,6 +80,7 @@ int test3 (std::string const& f,
     }
     parser.registerVariables(variables);
     auto const exe = parser.compile<3>();
+    auto const exe_lowered = parser.compile<3>(true);
     max_stack_size = std::max(max_stack_size, parser.maxStackSize());
 
     GpuArray<Real,3> dx{(hi[0]-lo[0]) / (N-1),
@@ -80,6 +94,12 @@ int test3 (std::string const& f,
         Real y = lo[1] + j*dx[1];
         Real z = lo[2] + k*dx[2];
         Real result = exe(x,y,z);
+        Real result_lowered = exe_lowered(x,y,z);
+        if (result_lowered != result && !(std::isnan(result_lowered) && std::isnan(result))) {
+            amrex::Print() << "    lowered f(" << x << "," << y << "," << z << ") = " << result_lowered << ", "
+                           << result << "\n";
+            ++nfail;
+        }
         Real benchmark = fb(x,y,z);
         Real abserror = std::abs(result-benchmark);
         Real relerror = abserror / (1.e-50 + std::max(std::abs(result),std::abs(benchmark)));
@@ -113,6 +133,7 @@ int test4 (std::string const& f,
     }
     parser.registerVariables(variables);
     auto const exe = parser.compile<4>();
+    auto const exe_lowered = parser.compile<4>(true);
     max_stack_size = std::max(max_stack_size, parser.maxStackSize());
 
     GpuArray<Real,4> dx{(hi[0]-lo[0]) / (N-1),
@@ -129,6 +150,12 @@ int test4 (std::string const& f,
         Real z = lo[2] + k*dx[2];
         Real t = lo[3] + m*dx[3];
         Real result = exe(x,y,z,t);
+        Real result_lowered = exe_lowered(x,y,z,t);
+        if (result_lowered != result && !(std::isnan(result_lowered) && std::isnan(result))) {
+            amrex::Print() << "    lowered f(" << x << "," << y << "," << z << "," << t << ") = " << result_lowered << ", "
+                           << result << "\n";
+            ++nfail;
+        }
         Real benchmark = fb(x,y,z,t);
         Real abserror = std::abs(result-benchmark);
         Real relerror = abserror / (1.e-50 + std::max(std::abs(result),std::abs(benchmark)));
@@ -147,6 +174,48 @@ int test4 (std::string const& f,
     }
 }
 
+int benchmark3 (std::string const& f, std::map<std::string,Real> const& constants, int N)
+{
+    Parser parser(f);
+    for (auto const& kv : constants) {
+        parser.setConstant(kv.first, kv.second);
+    }
+    parser.registerVariables({"x","y","z"});
+    auto const exe = parser.compileHost<3>();
+    auto const exe_lowered = parser.compileHost<3>(true);
+
+    Vector<double> x(N), y(N), z(N), r0(N), r1(N), r2(N);
+    for (int i = 0; i < N; ++i) {
+        x[i] = -1.0 + 2.0*i/N;
+        y[i] = 0.5 - 1.5*i/N;
+        z[i] = 0.25 + 0.5*i/N;
+    }
+
+    double t0 = amrex::second();
+    for (int i = 0; i < N; ++i) {
+        r0[i] = exe(x[i],y[i],z[i]);
+    }
+    double t1 = amrex::second();
+    for (int i = 0; i < N; ++i) {
+        r1[i] = exe_lowered(x[i],y[i],z[i]);
+    }
+    double t2 = amrex::second();
+    double const* xyz[] = {x.data(), y.data(), z.data()};
+    parser.evalBatch<3>(xyz, r2.data(), N);
+    double t3 = amrex::second();
+
+    int nfail = 0;
+    for (int i = 0; i < N; ++i) {
+        if ((r1[i] != r0[i] || r2[i] != r0[i]) &&
+            !(std::isnan(r0[i]) && std::isnan(r1[i]) && std::isnan(r2[i]))) { ++nfail; }
+    }
+
+    amrex::Print() << "  \"" << f.substr(0,60) << (f.size() > 60 ? "...\"" : "\"") << "\n"
+                   << "      stack: " << t1-t0 << ", lowered: " << t2-t1
+                   << ", batch: " << t3-t2 << (nfail ? "   mismatch!" : "") << "\n";
+    return nfail > 0;
+}
+
 int main (int argc, char* argv[])
 {
     amrex::Initialize(argc, argv);
@@ -357,6 +426,64 @@ int main (int argc, char* argv[])
                         {0.e-6, 0.0, -20.e-6}, {20.e-6, 1.e-10, 20.e-6}, 100,
                         1.e-12, 1.e-15);
 
+        {
+            int nbench = 1000000;
+            ParmParse pp;
+            pp.query("nbench", nbench);
+            amrex::Print() << "\nTiming " << nbench << " evaluations\n";
+            nerror += benchmark3("r2=(z-zc)*(z-zc)+(y-yc)*(y-yc)+(x-xc)*(x-xc); r=sqrt(r2); if(r < (r_star-dR), 0.0, if(r <= r_star, dens, 0.0))",
+                                 {{"xc", 0.1}, {"yc", -1.0}, {"zc", 0.2}, {"r_star", 0.73}, {"dR", 0.57}, {"dens", 12.}},
+                                 nbench);
+            nerror += benchmark3("( ((( (z-zc)*(z-zc) + (y-yc)*(y-yc) + (x-xc)*(x-xc) )^(0.5))<=r_star) * ((( (z-zc)*(z-zc) + (y-yc)*(y-yc) + (x-xc)*(x-xc) )^(0.5))>=(r_star-dR)) )*dens",
+                                 {{"xc", 0.1}, {"yc", -1.0}, {"zc", 0.2}, {"r_star", 0.73}, {"dR", 0.57}, {"dens", 12.}},
+                                 nbench);
+            nerror += benchmark3("epsilon/kp*2*x/w0**2*exp(-(x**2+y**2)/w0**2)*sin(k0*z)",
+                                 {{"epsilon",0.01},{"kp",3.5},{"w0",5.e-6},{"k0",3.e5}},
+                                 nbench);
+            nerror += benchmark3("a*x*x*x + b*x*x*y + c*x*y*y + d*y*y*y + e*z*(x*x + y*y) + 3.5*z",
+                                 {{"a",1.1},{"b",-0.3},{"c",2.4},{"d",0.7},{"e",-1.3}},
+                                 nbench);
+        }
+
+        {
+            amrex::Print() << "\nTesting Parser::evalBatch on a box\n";
+            Gpu::LaunchSafeGuard lsg(false); // evaluate on the host
+            Parser parser("r2=x*x+y*y; if(r2 < 0.25, cos(r2)*z, r2*r2-z)");
+            parser.registerVariables({"x","y","z"});
+            auto exe = parser.compileHost<3>();
+            Box bx(IntVect(0), IntVect(AMREX_D_DECL(40,7,5)));
+            FArrayBox fab(bx, 2, The_Pinned_Arena());
+            auto const& a = fab.array();
+            auto const& ca = fab.const_array();
+            parser.evalBatch<3>(bx, a, 0, [=] AMREX_GPU_HOST_DEVICE (int i, int j, int k)
+            {
+                return GpuArray<double,3>{i*0.05-1.0, j*0.1-0.3, k*0.2};
+            });
+            parser.evalBatch<3>(bx, a, 1, [=] AMREX_GPU_HOST_DEVICE (int i, int j, int k)
+            {
+                return GpuArray<double,3>{i*0.05-1.0, j*0.1-0.3, double(ca(i,j,k,0))};
+            });
+            amrex::LoopOnCpu(bx, [&] (int i, int j, int k)
+            {
+                Real v0 = static_cast<Real>(exe(i*0.05-1.0, j*0.1-0.3, k*0.2));
+                Real v1 = static_cast<Real>(exe(i*0.05-1.0, j*0.1-0.3, double(v0)));
+                if (a(i,j,k,0) != v0 || a(i,j,k,1) != v1) { ++nerror; }
+            });
+        }
+
+        {
+            amrex::Print() << "\nTesting that the branch of if not taken is not evaluated\n";
+            Parser parser("if(x>0, log(x), 0.0) + if(x!=0, 1/x, 0.0)");
+            parser.registerVariables({"x"});
+            auto const exe = parser.compileHost<1>(true);
+            std::feclearexcept(FE_ALL_EXCEPT);
+            double r = exe(0.0) + exe(-1.0);
+            if (std::fetestexcept(FE_DIVBYZERO | FE_INVALID) || r != -1.0) {
+                amrex::Print() << "    failed\n";
+                ++nerror;
+            }
+        }
+
         amrex::Print() << "\nMax stack size is " << max_stack_size << "\n";
         if (nerror > 0) {
             amrex::Print() << nerror << " tests failed\n";
@@ -434,6 +561,38 @@ int main (int argc, char* argv[])
                 }
             }
         }
+        {
+            amrex::Print() << count++ << ". Testing IParser::evalBatch\n";
+            Gpu::LaunchSafeGuard lsg(false); // evaluate on the host
+            IParser iparser("if(x<y, x*3 + y//2, if(x>40, x-y, 7)) + abs(x*y)/5");
+            iparser.registerVariables({"x","y"});
+            auto exe = iparser.compileHost<2>();
+            constexpr int n = 101;
+            Vector<int> xv(n), yv(n), r(n);
+            for (int i = 0; i < n; ++i) {
+                xv[i] = i - 30;
+                yv[i] = (i < 50) ? 100 : 10 - i/3;
+            }
+            int const* xy[] = {xv.data(), yv.data()};
+            iparser.evalBatch<2>(xy, r.data(), n);
+            for (int i = 0; i < n; ++i) {
+                AMREX_ALWAYS_ASSERT(r[i] == exe(xv[i],yv[i]));
+            }
+
+            Box bx(IntVect(0), IntVect(AMREX_D_DECL(12,5,3)));
+            IArrayBox ifab(bx, 3, The_Pinned_Arena());
+            auto const& a = ifab.array();
+            amrex::LoopOnCpu(bx, [&] (int i, int j, int k)
+            {
+                a(i,j,k,0) = i*3 - j*7 + k;
+                a(i,j,k,1) = j*5 - k;
+            });
+            iparser.evalBatch<2>(bx, a, 2, ifab.const_array(), 0);
+            amrex::LoopOnCpu(bx, [&] (int i, int j, int k)
+            {
+                AMREX_ALWAYS_ASSERT(a(i,j,k,2) == exe(i*3-j*7+k, j*5-k));
+            });
+        }
         amrex::Print() << "\nAll IParser tests passed\n\n";
     }
 
@@ -134,7 +134,10 @@ void test ()
 
             amrex::Print() << "Writing particle file [" << fname << "] ..." << std::endl;
 
+            // These are no-ops unless particles.use_prepost is set.
+            myPC.CheckpointPre();
             myPC.Checkpoint(fname, "particle0", false, particle_realnames, particle_intnames);
+            myPC.CheckpointPost();
 
             amrex::Print() << " done \n";
         }
@@ -170,6 +173,47 @@ void test ()
 
             AMREX_ALWAYS_ASSERT(sm_old == sm_new);
         }
+
+        // Restart onto different grids, which reads the particles with a
+        // distribution mapping balanced by the particle counts in the file.
+        Vector<BoxArray> ba2(nlevs);
+        Vector<DistributionMapping> dmap2(nlevs);
+        for (int lev = 0; lev < nlevs; lev++) {
+            ba2[lev] = BoxArray(ba[lev]).coarsen(2).maxSize(max_grid_size).refine(2);
+            dmap2[lev] = DistributionMapping{ba2[lev]};
+        }
+        MyPC dualPC(geom, dmap2, ba2, ref_ratio);
+        dualPC.Restart(directory_path, "particle0");
+        AMREX_ALWAYS_ASSERT(dualPC.TotalNumberOfParticles() == myPC.TotalNumberOfParticles());
+
+        // The per-grid index: the counts add up, the bounding boxes lie in
+        // their grids, and a region query finds every particle in the region.
+        for (int lev = 0; lev < nlevs; lev++) {
+            auto index = ReadParticleIndex(directory_path, "particle0", lev);
+            AMREX_ALWAYS_ASSERT(Long(index.size()) == ba[lev].size());
+            Long nindex = 0;
+            for (int i = 0; i < int(index.size()); ++i) {
+                nindex += index[i].count;
+                if (index[i].count > 0) {
+                    RealBox grid_box(ba[lev][i], geom[lev].CellSize(), geom[lev].ProbLo());
+                    AMREX_ALWAYS_ASSERT(grid_box.contains(index[i].bbox, 1.e-6_rt));
+                }
+            }
+            AMREX_ALWAYS_ASSERT(nindex == myPC.NumberOfParticlesAtLevel(lev));
+
+            RealBox region({AMREX_D_DECL(0.1_rt,0.1_rt,0.1_rt)}, {AMREX_D_DECL(0.3_rt,0.3_rt,0.3_rt)});
+            auto grids = ParticleGridsInRegion(index, region);
+            AMREX_ALWAYS_ASSERT(!grids.empty() && grids.size() < index.size());
+            Long nquery = 0;
+            for (int i : grids) { nquery += index[i].count; }
+            Long nregion = amrex::ReduceSum(myPC,
+                [=] AMREX_GPU_HOST_DEVICE (const PType& p) -> Long
+                {
+                    return region.contains(RealVect(AMREX_D_DECL(p.pos(0),p.pos(1),p.pos(2)))) ? 1 : 0;
+                });
+            ParallelDescriptor::ReduceLongSum(nregion);
+            AMREX_ALWAYS_ASSERT(nregion > 0 && nregion <= nquery);
+        }
     }
 }
 
@@ -193,6 +193,21 @@ void test ()
             amrex::Print() << sm_old << " " << sm_new << "\n";
             AMREX_ALWAYS_ASSERT(sm_old == sm_new);
         }
+
+        // The per-grid index is written by the sync and the async writers.
+        for (int lev = 0; lev < nlevs; lev++) {
+            auto index = ReadParticleIndex(directory_path, "particle0", lev);
+            AMREX_ALWAYS_ASSERT(Long(index.size()) == ba[lev].size());
+            Long nindex = 0;
+            for (int i = 0; i < int(index.size()); ++i) {
+                nindex += index[i].count;
+                if (index[i].count > 0) {
+                    RealBox grid_box(ba[lev][i], geom[lev].CellSize(), geom[lev].ProbLo());
+                    AMREX_ALWAYS_ASSERT(grid_box.contains(index[i].bbox, 1.e-6_rt));
+                }
+            }
+            AMREX_ALWAYS_ASSERT(nindex == myPC.NumberOfParticlesAtLevel(lev));
+        }
     }
 }
 
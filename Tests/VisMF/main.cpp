@@ -0,0 +1,291 @@
+#include <AMReX.H>
+#include <AMReX_MultiFab.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_PlotFileUtil.H>
+#include <AMReX_Print.H>
+#include <AMReX_Utility.H>
+#include <AMReX_VisMF.H>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+using namespace amrex;
+
+namespace {
+
+Real max_diff (MultiFab const& a, MultiFab const& b, int scomp, int ncomp)
+{
+    MultiFab diff(a.boxArray(), a.DistributionMap(), ncomp, 0);
+    MultiFab::Copy(diff, a, scomp, 0, ncomp, 0);
+    MultiFab::Subtract(diff, b, 0, 0, ncomp, 0);
+    return diff.norm0(0, ncomp, IntVect(0));
+}
+
+void test_vismf (MultiFab const& mf, VisMF::Header::Version version,
+                 Real error_bound, std::string const& label)
+{
+    std::string const name = "vismf_test_" + std::to_string(int(version));
+    VisMF::SetHeaderVersion(version);
+
+    ParallelDescriptor::Barrier();
+    double t0 = amrex::second();
+    Long nbytes = VisMF::Write(mf, name, VisMF::NFiles, false, error_bound);
+    ParallelDescriptor::Barrier();
+    double t1 = amrex::second();
+
+    MultiFab mf2(mf.boxArray(), mf.DistributionMap(), mf.nComp(), mf.nGrowVect());
+    VisMF::Read(mf2, name);
+    double t2 = amrex::second() - t1;
+    t1 -= t0;
+
+    ParallelDescriptor::ReduceLongSum(nbytes);
+    ParallelDescriptor::ReduceRealMax(t1);
+    ParallelDescriptor::ReduceRealMax(t2);
+
+    Real err = max_diff(mf, mf2, 0, mf.nComp());
+    Long rawbytes = 0;
+    for (int i = 0; i < mf.size(); ++i) {
+        rawbytes += mf.fabbox(i).numPts() * mf.nComp() * Long(sizeof(Real));
+    }
+    amrex::Print() << "  " << label << ": " << nbytes << " bytes, ratio "
+                   << double(rawbytes)/double(nbytes) << ", write " << t1
+                   << " s, read " << t2 << " s, max error " << err << "\n";
+
+    if (error_bound > 0) {
+        AMREX_ALWAYS_ASSERT(err <= error_bound);
+    } else {
+        AMREX_ALWAYS_ASSERT(err == 0);
+    }
+
+    // Read in file order and copy to the distribution of mf.
+    {
+        auto const old_sync = VisMF::GetUseSynchronousReads();
+        auto const old_single = VisMF::GetUseSingleRead();
+        VisMF::SetUseSynchronousReads(true);
+        VisMF::SetUseSingleRead(true);
+        MultiFab mf3(mf.boxArray(), mf.DistributionMap(), mf.nComp(), mf.nGrowVect());
+        VisMF::Read(mf3, name);
+        VisMF::SetUseSynchronousReads(old_sync);
+        VisMF::SetUseSingleRead(old_single);
+        AMREX_ALWAYS_ASSERT(max_diff(mf2, mf3, 0, mf.nComp()) == 0);
+    }
+
+    // Read single components through the VisMF object.
+    VisMF vismf(name);
+    for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
+        for (int n = 0; n < mf.nComp(); ++n) {
+            FArrayBox const& fab = vismf.GetFab(mfi.index(), n);
+            auto const& a = mf.const_array(mfi, n);
+            auto const& b = fab.const_array();
+            amrex::LoopOnCpu(fab.box(), [&] (int i, int j, int k)
+            {
+                Real e = std::abs(a(i,j,k) - b(i,j,k));
+                AMREX_ALWAYS_ASSERT(error_bound > 0 ? e <= error_bound : e == 0);
+            });
+        }
+        vismf.clear(mfi.index());
+    }
+}
+
+// A chain of delta writes in separate directories, as in delta checkpoints.
+void test_delta (MultiFab const& mf, VisMF::Header::Version version)
+{
+    VisMF::SetHeaderVersion(version);
+    MultiFab mf2(mf.boxArray(), mf.DistributionMap(), mf.nComp(), mf.nGrowVect());
+    MultiFab::Copy(mf2, mf, 0, 0, mf.nComp(), mf.nGrowVect());
+
+    std::string ref;
+    Long nbytes0 = 0;
+    for (int step = 0; step < 3; ++step) {
+        if (step > 0) {
+            // change one fab
+            for (MFIter mfi(mf2); mfi.isValid(); ++mfi) {
+                if (mfi.index() == step) {
+                    mf2[mfi].plus<RunOn::Device>(Real(step));
+                }
+            }
+        }
+        std::string const prefix = "vismf_test_delta_" + std::to_string(int(version)) + "_";
+        std::string const dir = prefix + std::to_string(step);
+        amrex::UtilCreateCleanDirectory(dir, true);
+        std::string const name = dir + "/Level_0/mf";
+        amrex::UtilCreateDirectory(dir + "/Level_0", 0755);
+        ParallelDescriptor::Barrier();
+        Long nbytes = VisMF::WriteDelta(mf2, name, ref);
+        ParallelDescriptor::ReduceLongSum(nbytes);
+        ref = name;
+
+        MultiFab mf3(mf.boxArray(), mf.DistributionMap(), mf.nComp(), mf.nGrowVect());
+        VisMF::Read(mf3, name);
+        MultiFab::Subtract(mf3, mf2, 0, 0, mf.nComp(), mf.nGrowVect());
+        Real err = mf3.norminf(0, mf.nComp(), mf.nGrowVect());
+        amrex::Print() << "  step " << step << ": " << nbytes << " bytes, max error "
+                       << err << "\n";
+        AMREX_ALWAYS_ASSERT(err == 0);
+
+        // Only the fab changed in this step is written.  The others refer to
+        // the directory of the step that last wrote them.
+        if (step == 0) {
+            nbytes0 = nbytes;
+        } else {
+            AMREX_ALWAYS_ASSERT(mf.size() >= 4 && nbytes < nbytes0/2);
+        }
+        if (ParallelDescriptor::IOProcessor()) {
+            VisMF::Header hdr;
+            std::ifstream ifs(name + "_H");
+            ifs >> hdr;
+            AMREX_ALWAYS_ASSERT(static_cast<int>(hdr.m_fod.size()) == mf.size());
+            for (int k = 0; k < mf.size(); ++k) {
+                std::string const& fname = hdr.m_fod[k].m_name;
+                int const last = (k >= 1 && k <= step) ? k : 0;
+                if (last == step) {
+                    AMREX_ALWAYS_ASSERT(fname.find('/') == std::string::npos);
+                } else {
+                    std::string const refdir = prefix + std::to_string(last) + "/Level_0/";
+                    AMREX_ALWAYS_ASSERT(fname.find(refdir) != std::string::npos);
+                }
+            }
+        }
+    }
+}
+
+// Direct writes, with all ranks appending to one file and to a file each.
+void test_direct_write (MultiFab const& mf)
+{
+    auto const old_nfiles = VisMF::GetNOutFiles();
+    VisMF::SetHeaderVersion(VisMF::Header::Version_v1);
+    VisMF::SetUseDirectWrite(true);
+    for (int nfiles : {1, ParallelDescriptor::NProcs()}) {
+        VisMF::SetNOutFiles(nfiles);
+        std::string const name = "vismf_test_direct_" + std::to_string(nfiles);
+        ParallelDescriptor::Barrier();
+        double t0 = amrex::second();
+        Long nbytes = VisMF::Write(mf, name);
+        ParallelDescriptor::Barrier();
+        t0 = amrex::second() - t0;
+        ParallelDescriptor::ReduceLongSum(nbytes);
+
+        MultiFab mf2(mf.boxArray(), mf.DistributionMap(), mf.nComp(), mf.nGrowVect());
+        VisMF::Read(mf2, name);
+        Real err = max_diff(mf, mf2, 0, mf.nComp());
+        amrex::Print() << "  " << nfiles << " files: " << nbytes << " bytes, write "
+                       << t0 << " s, max error " << err << "\n";
+        AMREX_ALWAYS_ASSERT(err == 0);
+    }
+    VisMF::SetUseDirectWrite(false);
+    VisMF::SetNOutFiles(old_nfiles);
+}
+
+}
+
+int main (int argc, char* argv[])
+{
+    amrex::Initialize(argc,argv);
+    {
+        int n_cell = 64;
+        int max_grid_size = 32;
+        Real error_bound = 1.e-6;
+        {
+            ParmParse pp;
+            pp.query("n_cell", n_cell);
+            pp.query("max_grid_size", max_grid_size);
+            pp.query("error_bound", error_bound);
+        }
+
+        Box domain(IntVect(0), IntVect(n_cell-1));
+        BoxArray ba(domain);
+        ba.maxSize(max_grid_size);
+        DistributionMapping dm(ba);
+        RealBox rb({AMREX_D_DECL(0.,0.,0.)}, {AMREX_D_DECL(1.,1.,1.)});
+        Geometry geom(domain, rb, 0, {AMREX_D_DECL(0,0,0)});
+        auto const dx = geom.CellSizeArray();
+
+        // A smooth field, a constant, and a field with a jump.
+        MultiFab mf(ba, dm, 3, 1);
+        for (MFIter mfi(mf); mfi.isValid(); ++mfi) {
+            auto const& a = mf.array(mfi);
+            amrex::ParallelFor(mfi.fabbox(), [=] AMREX_GPU_DEVICE (int i, int j, int k)
+            {
+                Real x = (i+0.5_rt)*dx[0];
+                Real y = (j+0.5_rt)*dx[1];
+                Real z = (AMREX_SPACEDIM == 3) ? (k+0.5_rt)*dx[2] : 0.5_rt;
+                a(i,j,k,0) = std::sin(6.28_rt*x) * std::cos(6.28_rt*y) * std::exp(-z);
+                a(i,j,k,1) = 1.5_rt;
+                a(i,j,k,2) = (x+y+z > 1.5_rt) ? 1.e5_rt*x : -y;
+            });
+        }
+        Gpu::streamSynchronize();
+
+        auto const old_version = VisMF::GetHeaderVersion();
+
+        amrex::Print() << "VisMF::Write and VisMF::Read:\n";
+        test_vismf(mf, VisMF::Header::Version_v1, 0, "Version_v1              ");
+        test_vismf(mf, VisMF::Header::NoFabHeaderFAMinMax_v1, 0, "NoFabHeaderFAMinMax_v1  ");
+        test_vismf(mf, VisMF::Header::Compressed_v1, 0, "Compressed_v1           ");
+        test_vismf(mf, VisMF::Header::Compressed_v1, error_bound, "Compressed_v1 lossy     ");
+        test_vismf(mf, VisMF::Header::Compressed_v2, 0, "Compressed_v2           ");
+        test_vismf(mf, VisMF::Header::Compressed_v2, error_bound, "Compressed_v2 lossy     ");
+
+        amrex::Print() << "VisMF::Write with direct writes:\n";
+        test_direct_write(mf);
+
+        amrex::Print() << "VisMF::WriteDelta:\n";
+        test_delta(mf, VisMF::Header::Version_v1);
+        test_delta(mf, VisMF::Header::Compressed_v1);
+        test_delta(mf, VisMF::Header::Compressed_v2);
+
+        // Plotfiles are written without ghost cells and read back with PlotFileData,
+        // both whole and as a slice through the memory mapped reader.
+        Vector<std::string> varnames{"smooth", "constant", "jump"};
+        Vector<Box> slices;
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+            slices.push_back(domain);
+            slices.back().setSmall(idim, n_cell/2).setBig(idim, n_cell/2);
+        }
+        for (auto version : {VisMF::Header::Version_v1, VisMF::Header::NoFabHeaderFAMinMax_v1,
+                             VisMF::Header::Compressed_v1, VisMF::Header::Compressed_v2})
+        {
+            amrex::Print() << "Plotfile with header version " << int(version) << ":\n";
+            VisMF::SetHeaderVersion(version);
+            Real eb = (version == VisMF::Header::Compressed_v1 ||
+                       version == VisMF::Header::Compressed_v2) ? error_bound : Real(0);
+            VisMF::SetPlotfileErrorBound(eb);
+            std::string const pltname = "vismf_test_plt_" + std::to_string(int(version));
+            WriteSingleLevelPlotfile(pltname, mf, varnames, geom, 0.0, 0);
+            PlotFileData pf(pltname);
+            for (int n = 0; n < mf.nComp(); ++n) {
+                MultiFab mfr = pf.get(0, varnames[n]);
+                AMREX_ALWAYS_ASSERT(mfr.boxArray() == ba);
+                MultiFab mfn(ba, mfr.DistributionMap(), 1, 0);
+                mfn.ParallelCopy(mf, n, 0, 1);
+                Real err = max_diff(mfn, mfr, 0, 1);
+
+                Real slice_err = 0;
+                for (auto const& slice : slices) {
+                    MultiFab mfs = pf.get(0, varnames[n], slice);
+                    for (MFIter mfi(mfs); mfi.isValid(); ++mfi) {
+                        Box const& bx = mfi.validbox() & slice;
+                        if (bx.ok()) {
+                            auto const& a = mfn.const_array(mfi);
+                            auto const& b = mfs.const_array(mfi);
+                            amrex::LoopOnCpu(bx, [&] (int i, int j, int k)
+                            {
+                                slice_err = std::max(slice_err, std::abs(a(i,j,k)-b(i,j,k)));
+                            });
+                        }
+                    }
+                }
+                ParallelDescriptor::ReduceRealMax(slice_err);
+
+                amrex::Print() << "  " << varnames[n] << ": max error " << err
+                               << ", slice max error " << slice_err << "\n";
+                AMREX_ALWAYS_ASSERT(err <= eb && slice_err <= eb);
+            }
+        }
+
+        VisMF::SetPlotfileErrorBound(0);
+        VisMF::SetHeaderVersion(old_version);
+    }
+    amrex::Finalize();
+}
@@ -198,31 +198,46 @@ void main_main()
     Real gmx = std::numeric_limits<Real>::lowest();
     Real gmn = std::numeric_limits<Real>::max();
 
+    // If the data range is given, only the slices need to be read.
+    const bool read_slices = ldef_mx && ldef_mn;
+
     for (int ilev = 0; ilev <= max_level; ++ilev) {
-        const MultiFab& pltmf = pf.get(ilev, compname);
-        gmx = std::max(gmx, pltmf.max(0));
-        gmn = std::min(gmn, pltmf.min(0));
+        IntVect rrlev {rr[ilev]};
+        for (int idim = dim; idim < AMREX_SPACEDIM; ++idim) {
+            rrlev[idim] = 1;
+        }
+
+        MultiFab pltmf;
+        if (!read_slices) {
+            pltmf = pf.get(ilev, compname);
+            gmx = std::max(gmx, pltmf.max(0));
+            gmn = std::min(gmn, pltmf.min(0));
+        }
+
+        iMultiFab mask;
         if (ilev < max_level) {
             IntVect ratio{pf.refRatio(ilev)};
             for (int idim = dim; idim < AMREX_SPACEDIM; ++idim) {
                 ratio[idim] = 1;
             }
-            const iMultiFab mask = makeFineMask(pltmf, pf.boxArray(ilev+1), ratio);
+            mask = makeFineMask(pf.boxArray(ilev), pf.DistributionMap(ilev),
+                                pf.boxArray(ilev+1), ratio);
+        }
+
+        for (int idir = ndir_begin; idir < ndir_end; ++idir) {
+            const Box& crsebox = amrex::coarsen(finebox[idir], rrlev);
+            if (read_slices) {
+                pltmf = pf.get(ilev, compname, crsebox);
+            }
+            const auto& data = datamf[idir].array(0); // there is only one box
+            IntVect rrslice = rrlev;
+            rrslice[idir] = 1;
             for (MFIter mfi(pltmf); mfi.isValid(); ++mfi) {
-                const auto& m = mask.array(mfi);
-                const auto& plt = pltmf.array(mfi);
-                const Box& bx = mfi.validbox();
-                IntVect rrlev {rr[ilev]};
-                for (int idim = dim; idim < AMREX_SPACEDIM; ++idim) {
-                    rrlev[idim] = 1;
-                }
-                for (int idir = ndir_begin; idir < ndir_end; ++idir) {
-                    const Box& crsebox = amrex::coarsen(finebox[idir], rrlev);
-                    const Box& ibox = bx & crsebox;
-                    if (ibox.ok()) {
-                        const auto& data = datamf[idir].array(0); // there is only one box
-                        IntVect rrslice = rrlev;
-                        rrslice[idir] = 1;
+                const Box& ibox = mfi.validbox() & crsebox;
+                if (ibox.ok()) {
+                    const auto& plt = pltmf.const_array(mfi);
+                    if (ilev < max_level) {
+                        const auto& m = mask.const_array(mfi);
                         amrex::For(ibox, [=] AMREX_GPU_DEVICE (int i, int j, int k)
                         {
                             if (m(i,j,k) == 0) { // not covered by fine
@@ -239,17 +254,7 @@ void main_main()
                                 }
                             }
                         });
-                    }
-                }
-            }
-        } else {
-            for (MFIter mfi(pltmf); mfi.isValid(); ++mfi) {
-                const auto& plt = pltmf.array(mfi);
-                const Box& bx = mfi.validbox();
-                for (int idir = ndir_begin; idir < ndir_end; ++idir) {
-                    const Box& ibox = bx & finebox[idir];
-                    if (ibox.ok()) {
-                        const auto& data = datamf[idir].array(0); // there is only one box
+                    } else {
                         amrex::ParallelFor(ibox, [=] AMREX_GPU_DEVICE (int i, int j, int k)
                         {
                             data(i,j,k) = plt(i,j,k);
@@ -260,8 +265,10 @@ void main_main()
         }
     }
 
-    amrex::Print() << " plotfile variable maximum = " << gmx << "\n"
-                   << " plotfile variable minimum = " << gmn << "\n";
+    if (!read_slices) {
+        amrex::Print() << " plotfile variable maximum = " << gmx << "\n"
+                       << " plotfile variable minimum = " << gmn << "\n";
+    }
 
     if (ldef_mx) {
         amrex::Print() << " resetting variable maximum to " << def_mx << "\n";